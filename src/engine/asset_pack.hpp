@@ -0,0 +1,40 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include "image.hpp"
+
+// Single-file archive of pre-decoded assets. Each entry is a blob aligned to
+// ASSET_PACK_ALIGNMENT, found by name (a path relative to the packed root)
+// through a hash-sorted index at the end of the file. Images are stored as
+// raw pixel rows, so opening a pack only maps it and asset_pack_get_image()
+// hands out views of the mapping: nothing is copied or decoded on load.
+// Other files are stored verbatim. Pack files are raw struct dumps and,
+// like frame captures, only valid for the build that wrote them.
+
+enum {
+	ASSET_PACK_ALIGNMENT = 64,
+};
+
+enum AssetType : uint32_t {
+	ASSET_TYPE_DATA,
+	ASSET_TYPE_IMAGE,
+};
+
+struct AssetPack;
+
+AssetPack* asset_pack_open(const char* path);
+void asset_pack_close(AssetPack* pack);
+
+// View of a packed image for renderer_load_texture(), valid until the pack is
+// closed; image_free() it when done. nullptr if `name` isn't an image.
+Image2D* asset_pack_get_image(const AssetPack* pack, const char* name);
+const void* asset_pack_get_data(const AssetPack* pack, const char* name, size_t& size);
+
+// Writing. Blobs are streamed to `path` as they are added and the index is
+// written by asset_pack_builder_finish(), which also frees the builder.
+struct AssetPackBuilder;
+
+AssetPackBuilder* asset_pack_builder_create(const char* path);
+bool asset_pack_add_image(AssetPackBuilder* builder, const char* name, const Image2D* image);
+bool asset_pack_add_data(AssetPackBuilder* builder, const char* name, const void* data, size_t size);
+bool asset_pack_builder_finish(AssetPackBuilder* builder);
@@ -0,0 +1,25 @@
+#pragma once
+#include "vmath.hpp"
+#include "image.hpp"
+#include "renderer.hpp"
+
+// Packs many images into a few large RGBA pages (skyline bottom-left).
+// Images are only referenced until atlas_build(), which uploads the pages.
+struct TextureAtlas;
+
+struct AtlasRegion {
+	int page;
+	int width, height;
+	vec2 uv_min, uv_max;
+};
+
+TextureAtlas* atlas_create(int page_width, int page_height, int padding = 1);
+void atlas_destroy(TextureAtlas* atlas);
+
+// Returns the region id of the image, or -1 if the atlas was already built.
+int atlas_add_image(TextureAtlas* atlas, const Image2D* image);
+bool atlas_build(TextureAtlas* atlas, TextureSpec spec);
+
+bool atlas_get_region(const TextureAtlas* atlas, int region, AtlasRegion& out);
+int atlas_get_page_count(const TextureAtlas* atlas);
+Texture2D atlas_get_page_texture(const TextureAtlas* atlas, int page);
@@ -1,4 +1,6 @@
+#pragma once
 #include <array>
+#include <atomic>
 #include <cstddef> 
 #include <utility> 
 #include <memory>
@@ -51,6 +53,83 @@ private:
 	size_t head, tail, count;
 };
 
+// Lock-free ring for exactly one producer thread and one consumer thread.
+// head/tail count up forever and are masked on access, so CAPACITY must be a
+// power of two. Each side keeps a cached copy of the other side's index and
+// only touches the shared atomic when the cache says the ring is full/empty.
+template <typename T, size_t CAPACITY = 1024>
+class SPSCCommandBuffer {
+	static_assert(CAPACITY > 0 && (CAPACITY & (CAPACITY - 1)) == 0, 
+	              "SPSCCommandBuffer capacity must be a power of two");
+
+public:
+	SPSCCommandBuffer() : head(0), cached_tail(0), tail(0), cached_head(0) {}
+
+	SPSCCommandBuffer(const SPSCCommandBuffer&) = delete;
+	SPSCCommandBuffer& operator=(const SPSCCommandBuffer&) = delete;
+
+	// producer side
+	bool push_command(const T& command) {
+		return push_commands(&command, 1) == 1;
+	}
+
+	size_t push_commands(const T* commands, size_t count) {
+		const size_t h = head.load(std::memory_order_relaxed);
+
+		if (CAPACITY - (h - cached_tail) < count)
+			cached_tail = tail.load(std::memory_order_acquire);
+
+		size_t free = CAPACITY - (h - cached_tail);
+		size_t n = count < free ? count : free;
+
+		for (size_t i = 0; i < n; i++)
+			buffer[(h + i) & MASK] = commands[i];
+
+		head.store(h + n, std::memory_order_release);
+		return n;
+	}
+
+	// consumer side
+	bool pop_front(T& command) {
+		return pop_front(&command, 1) == 1;
+	}
+
+	size_t pop_front(T* commands, size_t max_count) {
+		const size_t t = tail.load(std::memory_order_relaxed);
+
+		if (cached_head - t < max_count)
+			cached_head = head.load(std::memory_order_acquire);
+
+		size_t available = cached_head - t;
+		size_t n = max_count < available ? max_count : available;
+
+		for (size_t i = 0; i < n; i++)
+			commands[i] = std::move(buffer[(t + i) & MASK]);
+
+		tail.store(t + n, std::memory_order_release);
+		return n;
+	}
+
+	// approximate when called while the other side is running
+	inline size_t size() const { 
+		return head.load(std::memory_order_acquire) - tail.load(std::memory_order_acquire); 
+	}
+	inline bool empty() const { return size() == 0; }
+	static constexpr size_t capacity() { return CAPACITY; }
+
+private:
+	static constexpr size_t MASK = CAPACITY - 1;
+	static constexpr size_t CACHE_LINE = 64;
+
+	alignas(CACHE_LINE) std::atomic<size_t> head;
+	size_t cached_tail;
+
+	alignas(CACHE_LINE) std::atomic<size_t> tail;
+	size_t cached_head;
+
+	alignas(CACHE_LINE) std::array<T, CAPACITY> buffer;
+};
+
 template<typename T, size_t STACK_SIZE = 1024>
 class DynamicCommandBuffer {
 public:
@@ -121,6 +200,9 @@ public:
 	size_t get_size() const { return size; }
 	bool empty() const { return size == 0; }
 
+	// index 0 is the front (next pop_front)
+	const T& get(size_t index) const { return buffer()[(tail + index) % capacity]; }
+
 private:
 	size_t head;
 	size_t tail;
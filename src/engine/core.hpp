@@ -1,6 +1,8 @@
 #pragma once
 
-void core_init();
+// headless selects GLFW's null platform where available (GLFW 3.4+), so no
+// display server is needed; pair it with WINDOWFLAG_HEADLESS windows.
+void core_init(bool headless = false);
 void core_update();
 void core_destroy();
 
@@ -0,0 +1,24 @@
+#pragma once
+
+// Change notifications for individual files, for reloading assets while the
+// game runs. Linux watches each file's directory with inotify, so editors
+// that save by renaming a temporary over the file are caught too. On other
+// platforms watches are accepted but never fire.
+//
+// Disabled by default; while disabled file_watch_add() does nothing, so the
+// engine can register everything it loads unconditionally.
+
+typedef void (*FileChangedFn)(const char* path, void* user);
+
+void file_watch_set_enabled(bool enabled);
+bool file_watch_is_enabled();
+
+// Returns a handle for file_watch_remove(), -1 if nothing is watched. A file
+// may be watched any number of times; callbacks run in the order added.
+int file_watch_add(const char* path, FileChangedFn callback, void* user);
+void file_watch_remove(int handle);
+
+// Runs the callbacks of files rewritten since the last call and returns how
+// many ran. Never blocks. renderer_begin() calls it, so the engine's reloads
+// happen on the thread that owns the GL context.
+int file_watch_poll();
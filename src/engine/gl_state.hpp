@@ -0,0 +1,34 @@
+#pragma once
+#include <cstdint>
+
+// Shadow copy of the GL bindings the engine touches. Every setter compares
+// against the cached value and only reaches the driver when it changes.
+// Engine code must go through these instead of the raw gl* calls, otherwise
+// the cache goes stale. Tracks the context current on the calling thread,
+// call gl_state_invalidate() after moving a context between threads.
+
+struct GLStateStats {
+	uint64_t issued;
+	uint64_t skipped;
+};
+
+void gl_state_invalidate();
+GLStateStats gl_state_get_stats();
+
+void gl_use_program(unsigned int program);
+void gl_bind_vertex_array(unsigned int vao);
+void gl_bind_buffer(unsigned int target, unsigned int buffer);
+void gl_bind_texture(unsigned int unit, unsigned int target, unsigned int texture);
+void gl_bind_framebuffer(unsigned int target, unsigned int framebuffer);
+
+void gl_set_blend(bool enabled);
+void gl_blend_func(unsigned int src, unsigned int dst);
+
+// Deleting a bound object implicitly unbinds it, these keep the cache in sync.
+// Programs are the exception: GL keeps a deleted current program in use, so
+// gl_delete_program() binds 0 first when it's the current one.
+void gl_delete_program(unsigned int program);
+void gl_delete_vertex_array(unsigned int vao);
+void gl_delete_buffer(unsigned int buffer);
+void gl_delete_texture(unsigned int texture);
+void gl_delete_framebuffer(unsigned int framebuffer);
@@ -1,5 +1,6 @@
 #pragma once
 #include <cstdlib>
+#include <future>
 
 enum class ImageSpec {
 	WIDTH,
@@ -9,8 +10,19 @@ enum class ImageSpec {
 
 struct Image2D;
 
-Image2D* image_load(const char* path);
+// `channels` 1-4 converts while decoding, 0 keeps the file's own count.
+Image2D* image_load(const char* path, int channels = 0);
+
+// Decodes on a shared worker pool (one thread per core, started on first
+// use); the future yields nullptr if the file can't be read.
+std::future<Image2D*> image_load_async(const char* path, int channels = 0);
+
+// Decodes `count` files concurrently into `images`, blocking until all are done.
+void image_load_batch(const char* const* paths, int count, Image2D** images, int channels = 0);
 Image2D* image_initialize(int width, int height, int channels);
+// Non-owning view of pixels that live elsewhere (e.g. a mapped asset pack);
+// image_free() leaves them alone and writes through the view are refused.
+Image2D* image_wrap(int width, int height, int channels, const unsigned char* data);
 void image_free(Image2D* image);
 
 bool image_get_pixel_handle(const Image2D* image, int x, int y, size_t& handle);
@@ -18,5 +30,10 @@ bool image_get_specification(const Image2D* image, ImageSpec spec, float& data);
 bool image_write_pixel(const Image2D* image, size_t handle, unsigned char value);
 const unsigned char* image_get_data(const Image2D* image);
 
+// Copies src into dst with its top-left corner at (x, y), converting between
+// channel counts (grey replicates, missing alpha is opaque). The `extrude`
+// pixels around the copy repeat src's edge texels. Clipped to dst.
+bool image_blit(Image2D* dst, const Image2D* src, int x, int y, int extrude = 0);
+
 
 
@@ -0,0 +1,357 @@
+#include "../asset_pack.hpp"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+enum {
+	PACK_MAGIC = 0x4B415041, // "APAK"
+	PACK_VERSION = 1,
+};
+
+// File layout: header, aligned blobs, then the index (entries sorted by
+// name hash, followed by the names they point into).
+struct PackHeader {
+	uint32_t magic, version;
+	uint32_t entry_count, names_size;
+	uint64_t index_offset;
+};
+
+struct PackEntry {
+	uint64_t name_hash;
+	uint64_t offset, size;
+	uint32_t name_offset, name_length;
+	uint32_t type;
+	int32_t width, height, channels;
+};
+
+struct AssetPack {
+	const unsigned char* base;
+	size_t size;
+
+	const PackEntry* entries;
+	uint32_t entry_count;
+	const char* names;
+
+#ifdef _WIN32
+	HANDLE file, mapping;
+#endif
+};
+
+struct AssetPackBuilder {
+	std::string path;
+	std::ofstream file;
+	uint64_t offset;
+
+	std::vector<PackEntry> entries;
+	std::string names;
+};
+
+// FNV-1a
+static uint64_t hash_name(const char* name, size_t length)
+{
+	uint64_t hash = 14695981039346656037ull;
+	for(size_t i=0; i<length; i++) {
+		hash ^= (unsigned char) name[i];
+		hash *= 1099511628211ull;
+	}
+	return hash;
+}
+
+static uint64_t align_offset(uint64_t offset)
+{
+	return (offset + ASSET_PACK_ALIGNMENT - 1) & ~uint64_t(ASSET_PACK_ALIGNMENT - 1);
+}
+
+//======================================================================//
+//                               MAPPING                                //
+//======================================================================//
+
+#ifdef _WIN32
+static bool map_file(const char* path, AssetPack& pack)
+{
+	pack.file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, nullptr,
+	                        OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+	if(pack.file == INVALID_HANDLE_VALUE) return false;
+
+	LARGE_INTEGER size;
+	if(!GetFileSizeEx(pack.file, &size) || size.QuadPart == 0) {
+		CloseHandle(pack.file);
+		return false;
+	}
+
+	pack.mapping = CreateFileMappingA(pack.file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+	if(!pack.mapping) {
+		CloseHandle(pack.file);
+		return false;
+	}
+
+	pack.base = (const unsigned char*) MapViewOfFile(pack.mapping, FILE_MAP_READ, 0, 0, 0);
+	pack.size = size_t(size.QuadPart);
+	if(!pack.base) {
+		CloseHandle(pack.mapping);
+		CloseHandle(pack.file);
+		return false;
+	}
+	return true;
+}
+
+static void unmap_file(AssetPack& pack)
+{
+	UnmapViewOfFile(pack.base);
+	CloseHandle(pack.mapping);
+	CloseHandle(pack.file);
+}
+#else
+static bool map_file(const char* path, AssetPack& pack)
+{
+	int fd = open(path, O_RDONLY);
+	if(fd < 0) return false;
+
+	struct stat info;
+	if(fstat(fd, &info) != 0 || info.st_size == 0) {
+		close(fd);
+		return false;
+	}
+
+	void* base = mmap(nullptr, size_t(info.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+	if(base == MAP_FAILED) return false;
+
+	// blobs are read front to back as they get uploaded, start paging them in
+	madvise(base, size_t(info.st_size), MADV_WILLNEED);
+
+	pack.base = (const unsigned char*) base;
+	pack.size = size_t(info.st_size);
+	return true;
+}
+
+static void unmap_file(AssetPack& pack)
+{
+	munmap((void*) pack.base, pack.size);
+}
+#endif
+
+// Bounds-checks the header and every entry, so lookups can trust the index.
+static bool read_index(AssetPack& pack)
+{
+	if(pack.size < sizeof(PackHeader)) return false;
+
+	const PackHeader* header = (const PackHeader*) pack.base;
+	if(header->magic != PACK_MAGIC || header->version != PACK_VERSION) return false;
+
+	const uint64_t index_size = uint64_t(header->entry_count) * sizeof(PackEntry) + header->names_size;
+	if(header->index_offset > pack.size || index_size > pack.size - header->index_offset) return false;
+
+	pack.entries = (const PackEntry*) (pack.base + header->index_offset);
+	pack.entry_count = header->entry_count;
+	pack.names = (const char*) (pack.entries + pack.entry_count);
+
+	for(uint32_t i=0; i<pack.entry_count; i++) {
+		const PackEntry& entry = pack.entries[i];
+		if(entry.offset > header->index_offset || entry.size > header->index_offset - entry.offset)
+			return false;
+		if(uint64_t(entry.name_offset) + entry.name_length > header->names_size)
+			return false;
+
+		if(entry.type == ASSET_TYPE_IMAGE) {
+			if(entry.width <= 0 || entry.height <= 0 || entry.channels < 1 || entry.channels > 4)
+				return false;
+			if(uint64_t(entry.width) * entry.height * entry.channels != entry.size)
+				return false;
+		}
+	}
+
+	return true;
+}
+
+static const PackEntry* find_entry(const AssetPack* pack, const char* name)
+{
+	if(!pack || !name) return nullptr;
+
+	const size_t length = std::strlen(name);
+	const uint64_t hash = hash_name(name, length);
+	const PackEntry* end = pack->entries + pack->entry_count;
+
+	const PackEntry* it = std::lower_bound(pack->entries, end, hash,
+		[](const PackEntry& entry, uint64_t key) { return entry.name_hash < key; });
+
+	for(; it != end && it->name_hash == hash; it++) {
+		if(it->name_length == length && std::memcmp(pack->names + it->name_offset, name, length) == 0)
+			return it;
+	}
+	return nullptr;
+}
+
+AssetPack* asset_pack_open(const char* path)
+{
+	AssetPack* pack = new AssetPack {};
+	if(!map_file(path, *pack)) {
+		std::cout << "Can't open asset pack " << path << "\n";
+		delete pack;
+		return nullptr;
+	}
+
+	if(!read_index(*pack)) {
+		std::cout << "Not a compatible asset pack: " << path << "\n";
+		asset_pack_close(pack);
+		return nullptr;
+	}
+
+	return pack;
+}
+
+void asset_pack_close(AssetPack* pack)
+{
+	if(!pack) return;
+
+	unmap_file(*pack);
+	delete pack;
+}
+
+Image2D* asset_pack_get_image(const AssetPack* pack, const char* name)
+{
+	const PackEntry* entry = find_entry(pack, name);
+	if(!entry || entry->type != ASSET_TYPE_IMAGE) return nullptr;
+
+	return image_wrap(entry->width, entry->height, entry->channels, pack->base + entry->offset);
+}
+
+const void* asset_pack_get_data(const AssetPack* pack, const char* name, size_t& size)
+{
+	const PackEntry* entry = find_entry(pack, name);
+	size = entry ? size_t(entry->size) : 0;
+	return entry ? pack->base + entry->offset : nullptr;
+}
+
+//======================================================================//
+//                               BUILDING                               //
+//======================================================================//
+
+static void write_padding(AssetPackBuilder* builder)
+{
+	static const char zeros[ASSET_PACK_ALIGNMENT] = {};
+
+	uint64_t aligned = align_offset(builder->offset);
+	builder->file.write(zeros, std::streamsize(aligned - builder->offset));
+	builder->offset = aligned;
+}
+
+static bool add_entry(AssetPackBuilder* builder, const char* name, PackEntry entry, const void* data)
+{
+	if(!builder || !name || (!data && entry.size)) return false;
+
+	const size_t length = std::strlen(name);
+	entry.name_hash = hash_name(name, length);
+
+	for(const PackEntry& other : builder->entries) {
+		if(other.name_hash == entry.name_hash && other.name_length == length &&
+		   builder->names.compare(other.name_offset, length, name) == 0) {
+			std::cout << "Duplicate asset " << name << "\n";
+			return false;
+		}
+	}
+
+	write_padding(builder);
+	entry.offset = builder->offset;
+	entry.name_offset = uint32_t(builder->names.size());
+	entry.name_length = uint32_t(length);
+
+	builder->file.write((const char*) data, std::streamsize(entry.size));
+	builder->offset += entry.size;
+	builder->names.append(name, length);
+	builder->entries.push_back(entry);
+
+	return bool(builder->file);
+}
+
+AssetPackBuilder* asset_pack_builder_create(const char* path)
+{
+	AssetPackBuilder* builder = new AssetPackBuilder;
+	builder->path = path;
+	builder->file.open(path, std::ios::binary | std::ios::trunc);
+	if(!builder->file) {
+		std::cout << "Can't write asset pack " << path << "\n";
+		delete builder;
+		return nullptr;
+	}
+
+	// patched with the real counts once the index is written
+	PackHeader header = {};
+	builder->file.write((const char*) &header, sizeof(header));
+	builder->offset = sizeof(header);
+	return builder;
+}
+
+bool asset_pack_add_image(AssetPackBuilder* builder, const char* name, const Image2D* image)
+{
+	float width = 0, height = 0, channels = 0;
+	if(!image_get_specification(image, ImageSpec::WIDTH, width) ||
+	   !image_get_specification(image, ImageSpec::HEIGHT, height) ||
+	   !image_get_specification(image, ImageSpec::NUM_CHANNELS, channels))
+		return false;
+
+	PackEntry entry = {};
+	entry.type = ASSET_TYPE_IMAGE;
+	entry.width = int32_t(width);
+	entry.height = int32_t(height);
+	entry.channels = int32_t(channels);
+	entry.size = uint64_t(entry.width) * entry.height * entry.channels;
+	return add_entry(builder, name, entry, image_get_data(image));
+}
+
+bool asset_pack_add_data(AssetPackBuilder* builder, const char* name, const void* data, size_t size)
+{
+	PackEntry entry = {};
+	entry.type = ASSET_TYPE_DATA;
+	entry.size = size;
+	return add_entry(builder, name, entry, data);
+}
+
+bool asset_pack_builder_finish(AssetPackBuilder* builder)
+{
+	if(!builder) return false;
+
+	std::sort(builder->entries.begin(), builder->entries.end(),
+		[](const PackEntry& a, const PackEntry& b) { return a.name_hash < b.name_hash; });
+
+	write_padding(builder);
+
+	PackHeader header = {};
+	header.magic = PACK_MAGIC;
+	header.version = PACK_VERSION;
+	header.entry_count = uint32_t(builder->entries.size());
+	header.names_size = uint32_t(builder->names.size());
+	header.index_offset = builder->offset;
+
+	builder->file.write((const char*) builder->entries.data(),
+	                    std::streamsize(builder->entries.size() * sizeof(PackEntry)));
+	builder->file.write(builder->names.data(), std::streamsize(builder->names.size()));
+	builder->file.seekp(0);
+	builder->file.write((const char*) &header, sizeof(header));
+	builder->file.close();
+
+	bool written = !builder->file.fail();
+	if(!written) {
+		std::cout << "Failed writing asset pack " << builder->path << "\n";
+		std::remove(builder->path.c_str());
+	}
+
+	delete builder;
+	return written;
+}
@@ -0,0 +1,218 @@
+#include "../atlas.hpp"
+
+#include <vector>
+#include <algorithm>
+#include <climits>
+#include <iostream>
+
+struct SkylineSegment {
+	int x, y, width;
+};
+
+struct AtlasPage {
+	std::vector<SkylineSegment> skyline;
+	Texture2D texture;
+};
+
+struct AtlasEntry {
+	const Image2D* image;
+	int width, height;
+	int x, y;
+	int page;
+};
+
+struct TextureAtlas {
+	int page_width, page_height;
+	int padding;
+	bool built;
+	std::vector<AtlasEntry> entries;
+	std::vector<AtlasPage> pages;
+};
+
+//======================================================================//
+//                          SKYLINE PACKING                             //
+//======================================================================//
+
+// Lowest y a w-wide rect can rest at when its left edge is on segment i,
+// or -1 if it runs off the page.
+static int skyline_fit(const TextureAtlas* atlas, const AtlasPage& page, size_t i, int w, int h) {
+	int x = page.skyline[i].x;
+	if (x + w > atlas->page_width) return -1;
+
+	int y = 0, remaining = w;
+	for (; i < page.skyline.size() && remaining > 0; i++) {
+		y = std::max(y, page.skyline[i].y);
+		remaining -= page.skyline[i].width;
+	}
+
+	return (y + h <= atlas->page_height) ? y : -1;
+}
+
+static bool skyline_insert(const TextureAtlas* atlas, AtlasPage& page, int w, int h, int& out_x, int& out_y) {
+	int best_top = INT_MAX, best_x = INT_MAX;
+	size_t best_index = 0;
+
+	for (size_t i = 0; i < page.skyline.size(); i++) {
+		int y = skyline_fit(atlas, page, i, w, h);
+		if (y < 0) continue;
+
+		int x = page.skyline[i].x;
+		if (y + h < best_top || (y + h == best_top && x < best_x)) {
+			best_top = y + h;
+			best_x = x;
+			best_index = i;
+		}
+	}
+
+	if (best_top == INT_MAX) return false;
+
+	out_x = best_x;
+	out_y = best_top - h;
+
+	std::vector<SkylineSegment>& skyline = page.skyline;
+	skyline.insert(skyline.begin() + best_index, SkylineSegment { best_x, best_top, w });
+
+	// trim the segments now covered by the new one
+	for (size_t i = best_index + 1; i < skyline.size(); i++) {
+		int covered = (skyline[i - 1].x + skyline[i - 1].width) - skyline[i].x;
+		if (covered <= 0) break;
+
+		skyline[i].x += covered;
+		skyline[i].width -= covered;
+		if (skyline[i].width > 0) break;
+
+		skyline.erase(skyline.begin() + i);
+		i--;
+	}
+
+	for (size_t i = 0; i + 1 < skyline.size(); i++) {
+		if (skyline[i].y == skyline[i + 1].y) {
+			skyline[i].width += skyline[i + 1].width;
+			skyline.erase(skyline.begin() + i + 1);
+			i--;
+		}
+	}
+
+	return true;
+}
+
+static AtlasPage& atlas_new_page(TextureAtlas* atlas) {
+	AtlasPage page;
+	page.skyline.push_back({ 0, 0, atlas->page_width });
+	page.texture = { 0 };
+	atlas->pages.push_back(page);
+	return atlas->pages.back();
+}
+
+//======================================================================//
+//                             ATLAS API                                //
+//======================================================================//
+
+TextureAtlas* atlas_create(int page_width, int page_height, int padding) {
+	TextureAtlas* atlas = new TextureAtlas;
+	atlas->page_width = page_width;
+	atlas->page_height = page_height;
+	atlas->padding = padding;
+	atlas->built = false;
+	return atlas;
+}
+
+void atlas_destroy(TextureAtlas* atlas) {
+	if (!atlas) return;
+
+	for (AtlasPage& page : atlas->pages) {
+		if (page.texture.id)
+			renderer_delete_texture(page.texture);
+	}
+
+	delete atlas;
+}
+
+int atlas_add_image(TextureAtlas* atlas, const Image2D* image) {
+	if (!atlas || atlas->built || !image) return -1;
+
+	float width, height;
+	image_get_specification(image, ImageSpec::WIDTH, width);
+	image_get_specification(image, ImageSpec::HEIGHT, height);
+
+	atlas->entries.push_back({ image, int(width), int(height), 0, 0, -1 });
+	return int(atlas->entries.size() - 1);
+}
+
+bool atlas_build(TextureAtlas* atlas, TextureSpec spec) {
+	if (!atlas || atlas->built) return false;
+
+	// tallest first packs noticeably tighter on a skyline
+	std::vector<size_t> order(atlas->entries.size());
+	for (size_t i = 0; i < order.size(); i++) order[i] = i;
+	std::stable_sort(order.begin(), order.end(), [atlas](size_t a, size_t b) {
+		return atlas->entries[a].height > atlas->entries[b].height;
+	});
+
+	const int pad = atlas->padding;
+	for (size_t index : order) {
+		AtlasEntry& entry = atlas->entries[index];
+		int w = entry.width + 2 * pad;
+		int h = entry.height + 2 * pad;
+
+		if (w > atlas->page_width || h > atlas->page_height) {
+			std::cout << "Atlas: image " << index << " (" << entry.width << "x" << entry.height 
+			          << ") does not fit in a page\n";
+			continue;
+		}
+
+		for (size_t p = 0; p <= atlas->pages.size(); p++) {
+			AtlasPage& page = (p == atlas->pages.size()) ? atlas_new_page(atlas) : atlas->pages[p];
+			if (skyline_insert(atlas, page, w, h, entry.x, entry.y)) {
+				entry.x += pad;
+				entry.y += pad;
+				entry.page = int(p);
+				break;
+			}
+		}
+	}
+
+	for (size_t p = 0; p < atlas->pages.size(); p++) {
+		Image2D* page_image = image_initialize(atlas->page_width, atlas->page_height, 4);
+
+		for (const AtlasEntry& entry : atlas->entries) {
+			if (entry.page == int(p))
+				image_blit(page_image, entry.image, entry.x, entry.y, pad);
+		}
+
+		atlas->pages[p].texture = renderer_load_texture(page_image, spec);
+		image_free(page_image);
+	}
+
+	for (AtlasEntry& entry : atlas->entries)
+		entry.image = nullptr;
+
+	atlas->built = true;
+	return true;
+}
+
+bool atlas_get_region(const TextureAtlas* atlas, int region, AtlasRegion& out) {
+	if (!atlas || !atlas->built || region < 0 || region >= int(atlas->entries.size())) 
+		return false;
+
+	const AtlasEntry& entry = atlas->entries[region];
+	if (entry.page < 0) return false;
+
+	vec2 page_size(float(atlas->page_width), float(atlas->page_height));
+	out.page = entry.page;
+	out.width = entry.width;
+	out.height = entry.height;
+	out.uv_min = vec2(float(entry.x), float(entry.y)) / page_size;
+	out.uv_max = vec2(float(entry.x + entry.width), float(entry.y + entry.height)) / page_size;
+	return true;
+}
+
+int atlas_get_page_count(const TextureAtlas* atlas) {
+	return atlas ? int(atlas->pages.size()) : 0;
+}
+
+Texture2D atlas_get_page_texture(const TextureAtlas* atlas, int page) {
+	if (!atlas || page < 0 || page >= int(atlas->pages.size())) 
+		return Texture2D { 0 };
+	return atlas->pages[page].texture;
+}
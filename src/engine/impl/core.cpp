@@ -11,7 +11,12 @@ static struct {
   float delta_time;
 } g_CoreState;
 
-void core_init() {
+void core_init(bool headless) {
+#ifdef GLFW_PLATFORM_NULL
+  if(headless)
+    glfwInitHint(GLFW_PLATFORM, GLFW_PLATFORM_NULL);
+#endif
+
   if(!glfwInit()) {
     exit(0);
   }
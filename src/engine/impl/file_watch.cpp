@@ -0,0 +1,166 @@
+#include "../file_watch.hpp"
+
+#include <algorithm>
+#include <filesystem>
+#include <iostream>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#ifdef __linux__
+#include <sys/inotify.h>
+#include <unistd.h>
+#define FILE_WATCH_INOTIFY
+#endif
+
+struct WatchedFile {
+	int handle;
+	int directory; // inotify watch descriptor of the containing directory
+	std::string name, path;
+	FileChangedFn callback;
+	void* user;
+};
+
+//======================================================================//
+//                       GLOBAL FILE WATCH STATE                        //
+//======================================================================//
+static struct {
+	// add/remove may come from the simulation thread while the render
+	// thread polls
+	std::mutex mutex;
+	bool enabled = false;
+	int next_handle = 0;
+	std::vector<WatchedFile> files;
+
+#ifdef FILE_WATCH_INOTIFY
+	int fd = -1;
+#endif
+} g_FileWatchState;
+
+void file_watch_set_enabled(bool enabled)
+{
+	std::lock_guard<std::mutex> lock(g_FileWatchState.mutex);
+	g_FileWatchState.enabled = enabled;
+}
+
+bool file_watch_is_enabled()
+{
+	std::lock_guard<std::mutex> lock(g_FileWatchState.mutex);
+	return g_FileWatchState.enabled;
+}
+
+int file_watch_add(const char* path, FileChangedFn callback, void* user)
+{
+	std::lock_guard<std::mutex> lock(g_FileWatchState.mutex);
+	if (!g_FileWatchState.enabled || !path || !callback) return -1;
+
+	WatchedFile file;
+	file.handle = g_FileWatchState.next_handle++;
+	file.directory = -1;
+	file.path = path;
+	file.callback = callback;
+	file.user = user;
+
+#ifdef FILE_WATCH_INOTIFY
+	if (g_FileWatchState.fd < 0) {
+		g_FileWatchState.fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+		if (g_FileWatchState.fd < 0) {
+			std::cout << "inotify unavailable, asset reloading is off\n";
+			g_FileWatchState.enabled = false;
+			return -1;
+		}
+	}
+
+	std::filesystem::path file_path(path);
+	std::filesystem::path directory = file_path.parent_path();
+	if (directory.empty()) directory = ".";
+
+	// the kernel hands back the same descriptor for a directory already watched
+	file.directory = inotify_add_watch(g_FileWatchState.fd, directory.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO);
+	if (file.directory < 0) {
+		std::cout << "Can't watch " << directory.string() << "\n";
+		return -1;
+	}
+	file.name = file_path.filename().string();
+#endif
+
+	g_FileWatchState.files.push_back(std::move(file));
+	return g_FileWatchState.files.back().handle;
+}
+
+void file_watch_remove(int handle)
+{
+	std::lock_guard<std::mutex> lock(g_FileWatchState.mutex);
+	std::vector<WatchedFile>& files = g_FileWatchState.files;
+
+	auto it = std::find_if(files.begin(), files.end(),
+	                       [handle](const WatchedFile& file) { return file.handle == handle; });
+	if (it == files.end()) return;
+
+	int directory = it->directory;
+	files.erase(it);
+
+#ifdef FILE_WATCH_INOTIFY
+	bool shared = std::any_of(files.begin(), files.end(),
+	                          [directory](const WatchedFile& file) { return file.directory == directory; });
+	if (!shared && directory >= 0)
+		inotify_rm_watch(g_FileWatchState.fd, directory);
+#endif
+}
+
+// Copy of the live watch `handle`, false once it has been removed.
+static bool find_watch(int handle, WatchedFile& file)
+{
+	std::lock_guard<std::mutex> lock(g_FileWatchState.mutex);
+	for (const WatchedFile& other : g_FileWatchState.files) {
+		if (other.handle != handle) continue;
+		file = other;
+		return true;
+	}
+	return false;
+}
+
+int file_watch_poll()
+{
+	// callbacks run unlocked, they may add or remove watches themselves
+	std::vector<int> changed;
+
+#ifdef FILE_WATCH_INOTIFY
+	{
+		std::lock_guard<std::mutex> lock(g_FileWatchState.mutex);
+		if (g_FileWatchState.fd < 0) return 0;
+
+		alignas(inotify_event) char buffer[4096];
+		for (;;) {
+			ssize_t length = read(g_FileWatchState.fd, buffer, sizeof(buffer));
+			if (length <= 0) break;
+
+			for (char* p = buffer; p < buffer + length; ) {
+				const inotify_event* event = (const inotify_event*) p;
+				p += sizeof(inotify_event) + event->len;
+				if (event->len == 0) continue;
+
+				for (const WatchedFile& file : g_FileWatchState.files) {
+					if (file.directory != event->wd || file.name != event->name) continue;
+
+					if (std::find(changed.begin(), changed.end(), file.handle) == changed.end())
+						changed.push_back(file.handle);
+				}
+			}
+		}
+	}
+#endif
+
+	// an earlier callback may have removed a queued watch and freed its
+	// user data, handles are never reused so a removed one is just skipped
+	int ran = 0;
+	for (int handle : changed) {
+		WatchedFile file;
+		if (!find_watch(handle, file)) continue;
+
+		file.callback(file.path.c_str(), file.user);
+		ran++;
+	}
+
+	return ran;
+}
@@ -0,0 +1,208 @@
+#include "../gl_state.hpp"
+#include <glad/glad.h>
+#include <cstring>
+
+enum {
+	GL_STATE_TEXTURE_UNITS = 32,
+};
+
+enum TextureTarget {
+	TEXTURE_TARGET_2D,
+	TEXTURE_TARGET_2D_ARRAY,
+	TEXTURE_TARGET_COUNT,
+};
+
+// GL_ELEMENT_ARRAY_BUFFER is VAO state, so it is never cached.
+enum BufferTarget {
+	BUFFER_TARGET_ARRAY,
+	BUFFER_TARGET_PIXEL_UNPACK,
+	BUFFER_TARGET_COUNT,
+};
+
+static struct {
+	unsigned int program;
+	unsigned int vao;
+	unsigned int buffers[BUFFER_TARGET_COUNT];
+	unsigned int active_unit;
+	unsigned int textures[GL_STATE_TEXTURE_UNITS][TEXTURE_TARGET_COUNT];
+	unsigned int read_framebuffer, draw_framebuffer;
+	unsigned int blend_enabled;
+	unsigned int blend_src, blend_dst;
+
+	GLStateStats stats;
+} g_GLState;
+
+// Counts the call and returns true when the cached value has to change.
+static bool update(unsigned int& cached, unsigned int value)
+{
+	if (cached == value) {
+		g_GLState.stats.skipped++;
+		return false;
+	}
+
+	cached = value;
+	g_GLState.stats.issued++;
+	return true;
+}
+
+static int texture_target_index(unsigned int target)
+{
+	switch (target) {
+		case GL_TEXTURE_2D:       return TEXTURE_TARGET_2D;
+		case GL_TEXTURE_2D_ARRAY: return TEXTURE_TARGET_2D_ARRAY;
+		default:                  return -1;
+	}
+}
+
+static int buffer_target_index(unsigned int target)
+{
+	switch (target) {
+		case GL_ARRAY_BUFFER:        return BUFFER_TARGET_ARRAY;
+		case GL_PIXEL_UNPACK_BUFFER: return BUFFER_TARGET_PIXEL_UNPACK;
+		default:                     return -1;
+	}
+}
+
+void gl_state_invalidate()
+{
+	// all-ones never matches a real value, so every setter issues its next call
+	GLStateStats stats = g_GLState.stats;
+	std::memset(&g_GLState, 0xFF, sizeof(g_GLState));
+	g_GLState.stats = stats;
+}
+
+GLStateStats gl_state_get_stats()
+{
+	return g_GLState.stats;
+}
+
+void gl_use_program(unsigned int program)
+{
+	if (update(g_GLState.program, program))
+		glUseProgram(program);
+}
+
+void gl_bind_vertex_array(unsigned int vao)
+{
+	if (update(g_GLState.vao, vao))
+		glBindVertexArray(vao);
+}
+
+void gl_bind_buffer(unsigned int target, unsigned int buffer)
+{
+	int index = buffer_target_index(target);
+	if (index < 0) {
+		g_GLState.stats.issued++;
+		glBindBuffer(target, buffer);
+		return;
+	}
+
+	if (update(g_GLState.buffers[index], buffer))
+		glBindBuffer(target, buffer);
+}
+
+static void set_active_unit(unsigned int unit)
+{
+	if (update(g_GLState.active_unit, unit))
+		glActiveTexture(GL_TEXTURE0 + unit);
+}
+
+void gl_bind_texture(unsigned int unit, unsigned int target, unsigned int texture)
+{
+	int index = texture_target_index(target);
+	if (index < 0 || unit >= GL_STATE_TEXTURE_UNITS) {
+		set_active_unit(unit);
+		g_GLState.stats.issued++;
+		glBindTexture(target, texture);
+		return;
+	}
+
+	if (g_GLState.textures[unit][index] == texture) {
+		g_GLState.stats.skipped++;
+		return;
+	}
+
+	set_active_unit(unit);
+	update(g_GLState.textures[unit][index], texture);
+	glBindTexture(target, texture);
+}
+
+void gl_bind_framebuffer(unsigned int target, unsigned int framebuffer)
+{
+	if (target == GL_FRAMEBUFFER) {
+		if (g_GLState.read_framebuffer == framebuffer && g_GLState.draw_framebuffer == framebuffer) {
+			g_GLState.stats.skipped++;
+			return;
+		}
+
+		g_GLState.read_framebuffer = g_GLState.draw_framebuffer = framebuffer;
+		g_GLState.stats.issued++;
+		glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+		return;
+	}
+
+	unsigned int& bound = target == GL_READ_FRAMEBUFFER ? g_GLState.read_framebuffer 
+	                                                    : g_GLState.draw_framebuffer;
+	if (update(bound, framebuffer))
+		glBindFramebuffer(target, framebuffer);
+}
+
+void gl_set_blend(bool enabled)
+{
+	if (!update(g_GLState.blend_enabled, enabled)) return;
+
+	if (enabled) glEnable(GL_BLEND);
+	else         glDisable(GL_BLEND);
+}
+
+void gl_blend_func(unsigned int src, unsigned int dst)
+{
+	if (g_GLState.blend_src == src && g_GLState.blend_dst == dst) {
+		g_GLState.stats.skipped++;
+		return;
+	}
+
+	g_GLState.blend_src = src;
+	g_GLState.blend_dst = dst;
+	g_GLState.stats.issued++;
+	glBlendFunc(src, dst);
+}
+
+void gl_delete_program(unsigned int program)
+{
+	// a deleted program stays in use (and alive) until something else is
+	// bound, so unbind it for real rather than only in the cache
+	if (program && g_GLState.program == program) gl_use_program(0);
+	glDeleteProgram(program);
+}
+
+void gl_delete_vertex_array(unsigned int vao)
+{
+	if (g_GLState.vao == vao) g_GLState.vao = 0;
+	glDeleteVertexArrays(1, &vao);
+}
+
+void gl_delete_buffer(unsigned int buffer)
+{
+	for (unsigned int& bound : g_GLState.buffers) {
+		if (bound == buffer) bound = 0;
+	}
+	glDeleteBuffers(1, &buffer);
+}
+
+void gl_delete_texture(unsigned int texture)
+{
+	for (auto& unit : g_GLState.textures) {
+		for (unsigned int& bound : unit) {
+			if (bound == texture) bound = 0;
+		}
+	}
+	glDeleteTextures(1, &texture);
+}
+
+void gl_delete_framebuffer(unsigned int framebuffer)
+{
+	if (g_GLState.read_framebuffer == framebuffer) g_GLState.read_framebuffer = 0;
+	if (g_GLState.draw_framebuffer == framebuffer) g_GLState.draw_framebuffer = 0;
+	glDeleteFramebuffers(1, &framebuffer);
+}
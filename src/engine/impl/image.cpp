@@ -2,33 +2,135 @@
 
 #define STB_IMAGE_IMPLEMENTATION
 #include <stb/stb_image.h>
+#include <cstring>
+#include <string>
+#include <deque>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+enum class ImageStorage {
+	OWNED,
+	STBI,
+	BORROWED,
+};
 
 struct Image2D {
 	int width, height, channels;
 	unsigned char* data; 
-	bool stbi_allocated;
+	ImageStorage storage;
 };
 
-Image2D* image_load(const char* path) {
+Image2D* image_load(const char* path, int channels) {
 	Image2D* img = new Image2D;
-	img->data = stbi_load(path, &img->width, &img->height, &img->channels, 0);
-	img->stbi_allocated = true;
+	img->data = stbi_load(path, &img->width, &img->height, &img->channels, channels);
+	img->storage = ImageStorage::STBI;
 
 	if (!img->data) {
 		delete img;
 		return nullptr;
 	}
 
+	// stbi reports the file's channel count even when converting
+	if (channels > 0)
+		img->channels = channels;
+
 	return img;
 }
 
+//======================================================================//
+//                          IMAGE DECODE POOL                           //
+//======================================================================//
+
+// stbi_load keeps no shared state between calls, so whole files are decoded
+// in parallel, one per worker.
+static struct ImageLoaderState {
+	std::mutex mutex;
+	std::condition_variable wake;
+	std::deque<std::packaged_task<Image2D*()>> jobs;
+	std::vector<std::thread> workers;
+	bool stopping = false;
+
+	~ImageLoaderState() {
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			stopping = true;
+		}
+		wake.notify_all();
+
+		for (std::thread& worker : workers)
+			worker.join();
+	}
+} g_ImageLoaderState;
+
+static void image_worker_main() {
+	for (;;) {
+		std::packaged_task<Image2D*()> job;
+		{
+			std::unique_lock<std::mutex> lock(g_ImageLoaderState.mutex);
+			g_ImageLoaderState.wake.wait(lock, [] { 
+				return g_ImageLoaderState.stopping || !g_ImageLoaderState.jobs.empty(); 
+			});
+			if (g_ImageLoaderState.jobs.empty()) return;
+
+			job = std::move(g_ImageLoaderState.jobs.front());
+			g_ImageLoaderState.jobs.pop_front();
+		}
+		job();
+	}
+}
+
+std::future<Image2D*> image_load_async(const char* path, int channels) {
+	std::packaged_task<Image2D*()> job([file = std::string(path ? path : ""), channels] {
+		return image_load(file.c_str(), channels);
+	});
+	std::future<Image2D*> result = job.get_future();
+
+	{
+		std::lock_guard<std::mutex> lock(g_ImageLoaderState.mutex);
+		if (g_ImageLoaderState.workers.empty()) {
+			unsigned int count = std::thread::hardware_concurrency();
+			for (unsigned int i = 0; i < (count ? count : 1); i++)
+				g_ImageLoaderState.workers.emplace_back(image_worker_main);
+		}
+		g_ImageLoaderState.jobs.push_back(std::move(job));
+	}
+	g_ImageLoaderState.wake.notify_one();
+
+	return result;
+}
+
+void image_load_batch(const char* const* paths, int count, Image2D** images, int channels) {
+	std::vector<std::future<Image2D*>> results;
+	results.reserve(count);
+
+	for (int i = 0; i < count; i++)
+		results.push_back(image_load_async(paths[i], channels));
+
+	for (int i = 0; i < count; i++)
+		images[i] = results[i].get();
+}
+
 Image2D*  image_initialize(int width, int height, int channels) {
 	Image2D* image = new Image2D;
 	image->width = width;
 	image->height = height;
 	image->channels = channels;
-	image->data = new unsigned char[width * height * channels];
-	image->stbi_allocated = false;
+	image->data = new unsigned char[width * height * channels]();
+	image->storage = ImageStorage::OWNED;
+	return image;
+}
+
+Image2D* image_wrap(int width, int height, int channels, const unsigned char* data) {
+	if (!data) return nullptr;
+
+	Image2D* image = new Image2D;
+	image->width = width;
+	image->height = height;
+	image->channels = channels;
+	image->data = const_cast<unsigned char*>(data);
+	image->storage = ImageStorage::BORROWED;
 	return image;
 }
 
@@ -36,9 +138,9 @@ void image_free(Image2D* image) {
 	if (!image) return;
 
 	if (image->data) {
-		if (image->stbi_allocated) {
+		if (image->storage == ImageStorage::STBI) {
 			stbi_image_free(image->data);
-		} else {
+		} else if (image->storage == ImageStorage::OWNED) {
 			delete[] image->data;
 		}
 		image->data = nullptr;
@@ -77,7 +179,7 @@ bool image_get_specification(const Image2D* image, ImageSpec spec, float& data)
 }
 
 bool image_write_pixel(const Image2D* image, size_t handle, unsigned char value) {
-	if(!image || !image->data) return false;
+	if(!image || !image->data || image->storage == ImageStorage::BORROWED) return false;
 	image->data[handle] = value;
 	return true;
 }
@@ -87,3 +189,46 @@ const unsigned char* image_get_data(const Image2D* image) {
 	if (!image) return nullptr;
 	return image->data;
 }
+
+static void read_rgba(const Image2D* image, int x, int y, unsigned char rgba[4]) {
+	const unsigned char* p = image->data + (size_t(y) * image->width + x) * image->channels;
+	switch(image->channels) {
+		case 1 : rgba[0] = rgba[1] = rgba[2] = p[0]; rgba[3] = 255;  break;
+		case 2 : rgba[0] = rgba[1] = rgba[2] = p[0]; rgba[3] = p[1]; break;
+		case 3 : rgba[0] = p[0]; rgba[1] = p[1]; rgba[2] = p[2]; rgba[3] = 255; break;
+		default: rgba[0] = p[0]; rgba[1] = p[1]; rgba[2] = p[2]; rgba[3] = p[3]; break;
+	}
+}
+
+bool image_blit(Image2D* dst, const Image2D* src, int x, int y, int extrude) {
+	if(!dst || !src || !dst->data || !src->data || dst->storage == ImageStorage::BORROWED) return false;
+
+	for (int dy = -extrude; dy < src->height + extrude; dy++) {
+		int ty = y + dy;
+		if (ty < 0 || ty >= dst->height) continue;
+		int sy = dy < 0 ? 0 : (dy >= src->height ? src->height - 1 : dy);
+
+		for (int dx = -extrude; dx < src->width + extrude; dx++) {
+			int tx = x + dx;
+			if (tx < 0 || tx >= dst->width) continue;
+			int sx = dx < 0 ? 0 : (dx >= src->width ? src->width - 1 : dx);
+
+			unsigned char* out = dst->data + (size_t(ty) * dst->width + tx) * dst->channels;
+			if (dst->channels == src->channels) {
+				memcpy(out, src->data + (size_t(sy) * src->width + sx) * src->channels, src->channels);
+				continue;
+			}
+
+			unsigned char rgba[4];
+			read_rgba(src, sx, sy, rgba);
+			if (dst->channels <= 2) {
+				out[0] = rgba[0];
+				if (dst->channels == 2) out[1] = rgba[3];
+			} else {
+				memcpy(out, rgba, dst->channels);
+			}
+		}
+	}
+
+	return true;
+}
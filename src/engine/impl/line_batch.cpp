@@ -1,4 +1,7 @@
 #include "../line_batch.hpp"
+#include "../gl_state.hpp"
+#include "../quad_mesh.hpp"
+#include <cstddef>
 #include <glad/glad.h>
 
 
@@ -6,27 +9,39 @@
 //                       2D BATCHED LINE MESH                           //
 //======================================================================//
 
+enum LineInstanceKind {
+	LINE_INSTANCE_SEGMENT = 0,
+	LINE_INSTANCE_BOX     = 1,
+};
+
 LineBatch2D::LineBatch2D(size_t capacity)
-: BATCH_SIZE(capacity), vertex_array(capacity * 2) 
+: BATCH_SIZE(capacity), instance_array(capacity) 
 {
-	glGenVertexArrays(1, &vao);
-	glGenBuffers(1, &vbo);
+	create_quad_vao(vao, quad_vbo, ebo);
+
+	glGenBuffers(1, &instance_vbo);
+	gl_bind_buffer(GL_ARRAY_BUFFER, instance_vbo);
+	glBufferData(GL_ARRAY_BUFFER, BATCH_SIZE * sizeof(LineInstance2D), nullptr, GL_DYNAMIC_DRAW);
 
-	glBindVertexArray(vao);
-	glBindBuffer(GL_ARRAY_BUFFER, vbo);
-	glBufferData(GL_ARRAY_BUFFER, BATCH_SIZE * 2 * sizeof(LineVertex2D), nullptr, GL_DYNAMIC_DRAW);
+	glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, sizeof(LineInstance2D), (void*)offsetof(LineInstance2D, p1));
+	glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, sizeof(LineInstance2D), (void*)offsetof(LineInstance2D, p2));
+	glVertexAttribPointer(3, 4, GL_FLOAT, GL_FALSE, sizeof(LineInstance2D), (void*)offsetof(LineInstance2D, color));
+	glVertexAttribPointer(4, 1, GL_FLOAT, GL_FALSE, sizeof(LineInstance2D), (void*)offsetof(LineInstance2D, width));
+	glVertexAttribPointer(5, 1, GL_FLOAT, GL_FALSE, sizeof(LineInstance2D), (void*)offsetof(LineInstance2D, kind));
 
-	glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, sizeof(LineVertex2D), (void*)offsetof(LineVertex2D, position));
-	glEnableVertexAttribArray(0);
-	glVertexAttribPointer(1, 4, GL_FLOAT, GL_FALSE, sizeof(LineVertex2D), (void*)offsetof(LineVertex2D, color));
-	glEnableVertexAttribArray(1);
+	for(unsigned int attribute = 1; attribute <= 5; attribute++) {
+		glEnableVertexAttribArray(attribute);
+		glVertexAttribDivisor(attribute, 1);
+	}
 
-	glBindVertexArray(0);
+	gl_bind_vertex_array(0);
 }
 
 LineBatch2D::~LineBatch2D() {
-	glDeleteVertexArrays(1, &vao);
-	glDeleteBuffers(1, &vbo);
+	gl_delete_vertex_array(vao);
+	gl_delete_buffer(quad_vbo);
+	gl_delete_buffer(instance_vbo);
+	gl_delete_buffer(ebo);
 }
 
 void LineBatch2D::begin() {
@@ -38,24 +53,29 @@ void LineBatch2D::end() {
 	batch_open = false;
 }
 
-bool LineBatch2D::addLine(const Line2D& line) {
+bool LineBatch2D::_push(const LineInstance2D& instance) {
 	if (stack_top >= BATCH_SIZE || !batch_open)
 		return false;
 
-	size_t index = stack_top * 2;
-	vertex_array[index] = { line.begin, line.color };
-	vertex_array[index + 1] = { line.end, line.color };
-
-	stack_top++;
+	instance_array[stack_top++] = instance;
 	return true;
 }
 
+bool LineBatch2D::addLine(const Line2D& line) {
+	return _push({ line.begin, line.end, line.color, line.width, float(LINE_INSTANCE_SEGMENT) });
+}
+
+bool LineBatch2D::addBox(const Box2D& box) {
+	return _push({ box.min, box.max, box.color, box.width, float(LINE_INSTANCE_BOX) });
+}
+
 void LineBatch2D::drawBatch() {
-	glBindVertexArray(vao);
-	glBindBuffer(GL_ARRAY_BUFFER, vbo);
+	if (stack_top == 0) return;
+
+	gl_bind_vertex_array(vao);
+	gl_bind_buffer(GL_ARRAY_BUFFER, instance_vbo);
 
-	glBufferSubData(GL_ARRAY_BUFFER, 0, stack_top * 2 * sizeof(LineVertex2D), vertex_array.data());
+	glBufferSubData(GL_ARRAY_BUFFER, 0, stack_top * sizeof(LineInstance2D), instance_array.data());
 
-	glDrawArrays(GL_LINES, 0, 2 * stack_top);
-  glBindVertexArray(0);
+	glDrawElementsInstanced(GL_TRIANGLES, 6, GL_UNSIGNED_INT, 0, stack_top);
 }
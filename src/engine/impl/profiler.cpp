@@ -0,0 +1,209 @@
+#include "../profiler.hpp"
+#include "../renderer.hpp"
+
+#include <glad/glad.h>
+#include <algorithm>
+#include <chrono>
+#include <mutex>
+
+enum {
+	PROFILER_LATENCY = 3,
+	PROFILER_HISTORY = 128,
+};
+
+struct SampleHistory {
+	float samples[PROFILER_HISTORY];
+	uint32_t count, next;
+};
+
+struct PassQueries {
+	unsigned int query[PROFILER_LATENCY];
+	bool issued[PROFILER_LATENCY];
+};
+
+//======================================================================//
+//                        GLOBAL PROFILER STATE                         //
+//======================================================================//
+static struct {
+	bool initialized = false;
+	bool enabled = false;
+	bool gpu_timing = false;
+
+	uint32_t frame_slot;
+	PassQueries queries[PROFILE_PASS_COUNT];
+	std::chrono::steady_clock::time_point cpu_begin[PROFILE_PASS_COUNT];
+
+	// guards the histories, which the overlay/stat readers may access from
+	// another thread than the one recording
+	std::mutex history_mutex;
+	SampleHistory cpu[PROFILE_PASS_COUNT];
+	SampleHistory gpu[PROFILE_PASS_COUNT];
+} g_ProfilerState;
+
+static void history_push(SampleHistory& history, float value)
+{
+	history.samples[history.next] = value;
+	history.next = (history.next + 1) % PROFILER_HISTORY;
+	history.count = std::min<uint32_t>(history.count + 1, PROFILER_HISTORY);
+}
+
+static void history_stats(const SampleHistory& history, float& avg, float& p95, float& max)
+{
+	avg = p95 = max = 0.0f;
+	if (history.count == 0) return;
+
+	float sorted[PROFILER_HISTORY];
+	std::copy(history.samples, history.samples + history.count, sorted);
+	std::sort(sorted, sorted + history.count);
+
+	float sum = 0.0f;
+	for (uint32_t i = 0; i < history.count; i++)
+		sum += sorted[i];
+
+	avg = sum / history.count;
+	p95 = sorted[(history.count - 1) * 95 / 100];
+	max = sorted[history.count - 1];
+}
+
+void profiler_init(bool gpu_timing)
+{
+	if (g_ProfilerState.initialized) return;
+
+	for (PassQueries& pass : g_ProfilerState.queries) {
+		if (gpu_timing)
+			glGenQueries(PROFILER_LATENCY, pass.query);
+		std::fill(pass.issued, pass.issued + PROFILER_LATENCY, false);
+	}
+
+	g_ProfilerState.gpu_timing = gpu_timing;
+	g_ProfilerState.frame_slot = 0;
+	g_ProfilerState.initialized = true;
+}
+
+void profiler_shutdown()
+{
+	if (!g_ProfilerState.initialized) return;
+
+	if (g_ProfilerState.gpu_timing) {
+		for (PassQueries& pass : g_ProfilerState.queries)
+			glDeleteQueries(PROFILER_LATENCY, pass.query);
+	}
+
+	g_ProfilerState.initialized = false;
+}
+
+void profiler_set_enabled(bool enabled)
+{
+	g_ProfilerState.enabled = enabled;
+}
+
+bool profiler_is_enabled()
+{
+	return g_ProfilerState.enabled;
+}
+
+void profiler_new_frame()
+{
+	if (!g_ProfilerState.enabled || !g_ProfilerState.initialized || !g_ProfilerState.gpu_timing) return;
+
+	// the slot about to be reused was issued PROFILER_LATENCY frames ago
+	uint32_t slot = (g_ProfilerState.frame_slot + 1) % PROFILER_LATENCY;
+	g_ProfilerState.frame_slot = slot;
+
+	std::lock_guard<std::mutex> lock(g_ProfilerState.history_mutex);
+	for (int pass = 0; pass < PROFILE_PASS_COUNT; pass++) {
+		PassQueries& queries = g_ProfilerState.queries[pass];
+		if (!queries.issued[slot]) continue;
+		queries.issued[slot] = false;
+
+		GLint available = 0;
+		glGetQueryObjectiv(queries.query[slot], GL_QUERY_RESULT_AVAILABLE, &available);
+		if (!available) continue; // GPU is further behind than the latency, drop the sample
+
+		GLuint64 elapsed = 0;
+		glGetQueryObjectui64v(queries.query[slot], GL_QUERY_RESULT, &elapsed);
+		history_push(g_ProfilerState.gpu[pass], float(elapsed) * 1e-6f);
+	}
+}
+
+void profiler_begin_pass(ProfilePass pass)
+{
+	if (!g_ProfilerState.enabled || !g_ProfilerState.initialized) return;
+
+	if (g_ProfilerState.gpu_timing) {
+		PassQueries& queries = g_ProfilerState.queries[pass];
+		glBeginQuery(GL_TIME_ELAPSED, queries.query[g_ProfilerState.frame_slot]);
+	}
+	g_ProfilerState.cpu_begin[pass] = std::chrono::steady_clock::now();
+}
+
+void profiler_end_pass(ProfilePass pass)
+{
+	if (!g_ProfilerState.enabled || !g_ProfilerState.initialized) return;
+
+	auto cpu_end = std::chrono::steady_clock::now();
+	if (g_ProfilerState.gpu_timing) {
+		glEndQuery(GL_TIME_ELAPSED);
+		g_ProfilerState.queries[pass].issued[g_ProfilerState.frame_slot] = true;
+	}
+
+	std::chrono::duration<float, std::milli> elapsed = cpu_end - g_ProfilerState.cpu_begin[pass];
+
+	std::lock_guard<std::mutex> lock(g_ProfilerState.history_mutex);
+	history_push(g_ProfilerState.cpu[pass], elapsed.count());
+}
+
+ProfileTiming profiler_get_timing(ProfilePass pass)
+{
+	ProfileTiming timing;
+
+	std::lock_guard<std::mutex> lock(g_ProfilerState.history_mutex);
+	history_stats(g_ProfilerState.cpu[pass], timing.cpu_avg, timing.cpu_p95, timing.cpu_max);
+	history_stats(g_ProfilerState.gpu[pass], timing.gpu_avg, timing.gpu_p95, timing.gpu_max);
+	return timing;
+}
+
+const char* profiler_pass_name(ProfilePass pass)
+{
+	switch (pass) {
+		case PROFILE_PASS_CLEAR:   return "clear";
+		case PROFILE_PASS_LINES:   return "lines";
+		case PROFILE_PASS_SPRITES: return "sprites";
+		case PROFILE_PASS_TILEMAP: return "tilemap";
+		case PROFILE_PASS_UPLOAD:  return "upload";
+		case PROFILE_PASS_BLIT:    return "blit";
+		case PROFILE_PASS_SWAP:    return "swap";
+		default:                   return "unknown";
+	}
+}
+
+void profiler_draw_overlay(float x, float y, float ms_width, float bar_height)
+{
+	static const Color pass_colors[PROFILE_PASS_COUNT] = {
+		{ 0.55f, 0.55f, 0.55f, 0.9f },
+		{ 0.30f, 0.70f, 1.00f, 0.9f },
+		{ 1.00f, 0.60f, 0.20f, 0.9f },
+		{ 0.40f, 0.85f, 0.40f, 0.9f },
+		{ 0.90f, 0.35f, 0.35f, 0.9f },
+		{ 0.85f, 0.40f, 0.85f, 0.9f },
+		{ 0.95f, 0.85f, 0.30f, 0.9f },
+	};
+
+	float cpu_x = x, gpu_x = x;
+	float gpu_y = y + bar_height * 1.25f;
+
+	for (int pass = 0; pass < PROFILE_PASS_COUNT; pass++) {
+		ProfileTiming timing = profiler_get_timing(ProfilePass(pass));
+
+		float cpu_w = timing.cpu_avg * ms_width;
+		float gpu_w = timing.gpu_avg * ms_width;
+		if (cpu_w > 0) renderer_add_sprite(cpu_x, y, cpu_w, bar_height, pass_colors[pass]);
+		if (gpu_w > 0) renderer_add_sprite(gpu_x, gpu_y, gpu_w, bar_height, pass_colors[pass]);
+		cpu_x += cpu_w;
+		gpu_x += gpu_w;
+	}
+
+	float budget_x = x + 16.6f * ms_width;
+	renderer_add_line2d(budget_x, y - bar_height * 0.25f, budget_x, gpu_y + bar_height * 1.25f,
+	                    Color { 1.0f, 0.2f, 0.2f, 1.0f });
+}
@@ -0,0 +1,31 @@
+#include "../quad_mesh.hpp"
+#include "../gl_state.hpp"
+#include <glad/glad.h>
+
+void create_quad_vao(unsigned int& vao, unsigned int& quad_vbo, unsigned int& ebo)
+{
+	float quad_vertices[] = {
+		0, 0,
+		1, 0,
+		1, 1,
+		0, 1,
+	};
+
+	unsigned int quad_indices[] = {
+		0, 1, 2, 2, 3, 0,
+	};
+
+	glGenVertexArrays(1, &vao);
+	gl_bind_vertex_array(vao);
+
+	glGenBuffers(1, &quad_vbo);
+	gl_bind_buffer(GL_ARRAY_BUFFER, quad_vbo);
+	glBufferData(GL_ARRAY_BUFFER, sizeof(quad_vertices), quad_vertices, GL_STATIC_DRAW);
+
+	glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, 2 * sizeof(float), (void*) 0);
+	glEnableVertexAttribArray(0);
+
+	glGenBuffers(1, &ebo);
+	gl_bind_buffer(GL_ELEMENT_ARRAY_BUFFER, ebo);
+	glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(quad_indices), quad_indices, GL_STATIC_DRAW);
+}
@@ -2,27 +2,49 @@
 #include "../command_buffer.hpp"
 #include "../vmath.hpp"
 #include "../shader_program.hpp"
+#include "../gl_state.hpp"
+#include "../profiler.hpp"
 #include "../line_batch.hpp"
 #include "../sprite_batch.hpp"
+#include "../radix_sort.hpp"
+#include "../software_rasterizer.hpp"
+#include "../texture_upload.hpp"
+#include "../file_watch.hpp"
 
 #include "../shaders/line_shader.hpp"
 #include "../shaders/sprite_shader.hpp"
+#include "../shaders/tilemap_shader.hpp"
 
 #include <glad/glad.h>
 #include <GLFW/glfw3.h>
 #include <iostream>
+#include <vector>
+#include <mutex>
+#include <semaphore>
+#include <thread>
+#include <atomic>
+#include <tuple>
+#include <string>
+#include <fstream>
+#include <cstring>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define RENDERER_SIMD_CULL 1
+#endif
+#include <algorithm>
 
 enum class DrawCommandType {
 	NONE,
 
 	LINE2D,
 	BOX2D,
-
-	SPRITE,
 };
 
 enum RendererNumericLimits {
 	RNL_IMAGE_BIND_LIMIT = 32,
+	RNL_MAX_FRAME_LATENCY = 2,
+	RNL_UPLOAD_BUDGET = 4 * 1024 * 1024, // bytes per frame for async texture uploads
 };
 
 struct DrawCommand {
@@ -32,18 +54,123 @@ struct DrawCommand {
 
 	DrawCommandType type;
 	union {
-		struct { vec2 p1, p2; Color color; } line_2d_data;
-		struct { vec2 point, size; Color color; } box_2d_data;
-		struct { vec2 pos, size, uv_min, uv_max; int tex; Color color; } sprite_data;
+		struct { vec2 p1, p2; Color color; float width; } line_2d_data;
+		struct { vec2 point, size; Color color; float width; } box_2d_data;
 	};
 };
 
+struct SpriteRun {
+	uint32_t first;
+	uint8_t layer;
+	float depth;
+};
+
+// Sprites are written straight into a frame-lifetime instance array.
+// The only bookkeeping on submission is a run boundary whenever the
+// layer/depth changes; sort keys are derived from it at draw time.
+struct SpriteStream {
+	std::vector<Sprite> instances;
+	std::vector<SpriteRun> runs;
+	uint8_t layer = 0;
+	float depth = 0.0f;
+};
+
+// Recorded independently of the global state, so any thread may fill one.
+struct RenderList {
+	DynamicCommandBuffer<DrawCommand, 128> line_commands;
+	SpriteStream sprites;
+};
+
+struct SubmittedList {
+	uint32_t order;
+	RenderList* list;
+};
+
+struct CullRect {
+	vec2 min, max;
+	bool enabled;
+};
+
+struct CameraUniforms {
+	UniformHandle proj, view;
+};
+
+struct TilemapUniforms {
+	CameraUniforms camera;
+	UniformHandle tile_pixels, chunk_origin, chunk_size, chunk_tiles;
+};
+
+struct RenderTargetSpec {
+	int width, height;
+	RenderScale scale;
+};
+
+// Texture loaded from a file, re-imported in place when the file changes.
+struct WatchedTexture {
+	unsigned int id;
+	TextureSpec spec;
+	int watch;
+};
+
+// Offscreen color target renderer_begin() draws into when an internal
+// resolution is set.
+struct RenderTarget {
+	unsigned int fbo, color;
+	int width, height;
+};
+
+// Everything the render side needs to draw one frame. In pipelined mode the
+// simulation records into one slot while the render thread drains another.
+struct FrameSlot {
+	RenderList commands;
+	Camera camera;
+	int viewport_width = 0, viewport_height = 0;
+	RenderTargetSpec target_spec;
+	bool target_changed = false;
+
+	// texture bindings the frame was recorded with, carried into the next
+	// recording slot at submit so the render thread never sees later binds
+	int texture_slots[RNL_IMAGE_BIND_LIMIT] = {};
+	TextureArray texture_array = { 0, 0, 0, 0 };
+};
+
 static struct {
 	bool initialized = false; 
 
 	//========================================================
-	DynamicCommandBuffer<DrawCommand, 1024> line_command_buffer;
-	DynamicCommandBuffer<DrawCommand, 1024> sprite_command_buffer;
+	FrameSlot frames[RNL_MAX_FRAME_LATENCY + 1];
+	FrameSlot* record_frame = &frames[0];
+	FrameSlot* draw_frame = &frames[0];
+
+	//========================================================
+	std::vector<SortEntry> sprite_sort_entries;
+	std::vector<SortEntry> sprite_sort_scratch;
+
+	//========================================================
+	std::atomic<size_t> sprites_drawn{0}, sprites_culled{0};
+	std::atomic<size_t> lines_drawn{0}, lines_culled{0};
+
+	//========================================================
+	std::mutex submit_mutex;
+	std::vector<SubmittedList> submitted_lists;
+
+	//========================================================
+	bool pipelined = false;
+	const Window* window = nullptr;
+	RenderFrameFn render_frame = nullptr;
+	std::thread render_thread;
+	SPSCCommandBuffer<int, 4> ready_frames, free_frames;
+	std::counting_semaphore<> ready_count{0}, free_count{0};
+
+	//========================================================
+	RenderTargetSpec target_spec;
+	RenderTarget target;
+	int window_width, window_height;
+	bool headless;
+
+	//========================================================
+	std::mutex capture_mutex;
+	std::string capture_path;
 
 	//========================================================
 	LineBatch2D* line_batch_2d;
@@ -52,11 +179,26 @@ static struct {
 	//========================================================
 	Shader line_shader;
 	Shader sprite_shader;
+	Shader sprite_array_shader;
+	Shader tilemap_shader;
+
+	// uniform handles resolved once after linking
+	CameraUniforms line_uniforms;
+	CameraUniforms sprite_uniforms;
+	CameraUniforms sprite_array_uniforms;
+	TilemapUniforms tilemap_uniforms;
 
 	//========================================================
-	int texture_slots[RNL_IMAGE_BIND_LIMIT];
 	int bind_slot_max;
 	Texture2D white_texture;
+	Texture2D fallback_texture;
+	TextureUploader* uploader = nullptr;
+	std::vector<WatchedTexture> watched_textures;
+
+	//========================================================
+	// set with RENDERER_BACKEND_SOFTWARE, GL is then only used to present
+	SoftwareRasterizer* software = nullptr;
+	std::vector<SoftwareTexture*> software_textures; // indexed by Texture2D id - 1
 } g_RendererState;
 
 void Camera::updateProjection()
@@ -85,6 +227,18 @@ void Camera::updateView()
 }
 
 
+// Sprite sort key, most significant bits first:
+//   layer (8) | unused (24) | depth (32)
+// Layers always draw in order and depth orders sprites inside a layer; the
+// stable sort keeps submission order for equal keys. Texture isn't part of
+// the key: SpriteBatch binds every slot up front and never flushes on a
+// texture change, so grouping by it would only break painter's order
+// between overlapping blended sprites.
+static uint64_t make_sort_key(uint8_t layer, float depth)
+{
+	return (uint64_t(layer) << 56) | uint64_t(radix_float_to_key(depth));
+}
+
 static void add_line_2d(const DrawCommand& line) 
 {
 	Line2D l {
@@ -94,9 +248,15 @@ static void add_line_2d(const DrawCommand& line)
 			line.line_2d_data.color.g, 
 			line.line_2d_data.color.b,
 			line.line_2d_data.color.a
-		}
+		},
+		.width = line.line_2d_data.width
 	};
 
+	if(g_RendererState.software) {
+		g_RendererState.software->addLine(l.begin, l.end, l.color, l.width);
+		return;
+	}
+
 	if(!g_RendererState.line_batch_2d->addLine(l)) {
 		g_RendererState.line_batch_2d->end();
 		g_RendererState.line_batch_2d->drawBatch();
@@ -106,64 +266,471 @@ static void add_line_2d(const DrawCommand& line)
 	}
 }
 
-static void add_sprite(const DrawCommand& sprite)
+static void add_box_2d(const DrawCommand& box) 
 {
-	Sprite s {
-		.position = sprite.sprite_data.pos,
-		.size = sprite.sprite_data.size,
-		.uvmin = sprite.sprite_data.uv_min,
-		.uvmax = sprite.sprite_data.uv_max,
-		.color = vec4(sprite.sprite_data.color.r, sprite.sprite_data.color.g, sprite.sprite_data.color.b, sprite.sprite_data.color.a),
-		.texid = (float) sprite.sprite_data.tex
+	vec2 a = box.box_2d_data.point;
+	vec2 b = box.box_2d_data.point + box.box_2d_data.size;
+
+	Box2D bx {
+		.min = MIN(a, b),
+		.max = MAX(a, b),
+		.color = {box.box_2d_data.color.r,
+			box.box_2d_data.color.g, 
+			box.box_2d_data.color.b,
+			box.box_2d_data.color.a
+		},
+		.width = box.box_2d_data.width
 	};
 
-	if(!g_RendererState.sprite_batch->add(s)) {
-		g_RendererState.sprite_batch->end();
-		g_RendererState.sprite_batch->drawBatch();
-		g_RendererState.sprite_batch->begin();
+	if(g_RendererState.software) {
+		g_RendererState.software->addBox(bx.min, bx.max, bx.color, bx.width);
+		return;
+	}
+
+	if(!g_RendererState.line_batch_2d->addBox(bx)) {
+		g_RendererState.line_batch_2d->end();
+		g_RendererState.line_batch_2d->drawBatch();
+		g_RendererState.line_batch_2d->begin();
+
+		g_RendererState.line_batch_2d->addBox(bx);
+	}
+}
+
+static void flush_sprite_batch()
+{
+	g_RendererState.sprite_batch->end();
+	g_RendererState.sprite_batch->drawBatch();
+	g_RendererState.sprite_batch->begin();
+}
+
+static void add_sprite(const Sprite& s)
+{
+	if(g_RendererState.software) {
+		g_RendererState.software->addSprite(s);
+		return;
+	}
 
+	if(!g_RendererState.sprite_batch->add(s)) {
+		flush_sprite_batch();
 		g_RendererState.sprite_batch->add(s);
 	}
 }
 
-static void add_box_2d(const DrawCommand& box) 
+static void add_sprite_range(const Sprite* sprites, size_t count)
 {
-	DrawCommand l(DrawCommandType::LINE2D);
-	l.line_2d_data = {
-		.p1 = vec2(box.box_2d_data.point.x, box.box_2d_data.point.y),
-		.p2 = vec2(box.box_2d_data.point.x + box.box_2d_data.size.x, box.box_2d_data.point.y),
-		.color = box.box_2d_data.color
-	};
-	add_line_2d(l);
-	l.line_2d_data = {
-		.p1 = vec2(box.box_2d_data.point.x + box.box_2d_data.size.x, box.box_2d_data.point.y),
-		.p2 = vec2(box.box_2d_data.point.x + box.box_2d_data.size.x, box.box_2d_data.point.y + box.box_2d_data.size.y),
-		.color = box.box_2d_data.color
-	};
-	add_line_2d(l);
-	l.line_2d_data = {
-		.p1 = vec2(box.box_2d_data.point.x + box.box_2d_data.size.x, box.box_2d_data.point.y + box.box_2d_data.size.y),
-		.p2 = vec2(box.box_2d_data.point.x, box.box_2d_data.point.y + box.box_2d_data.size.y),
-		.color = box.box_2d_data.color
-	};
-	add_line_2d(l);
-	l.line_2d_data = {
-		.p1 = vec2(box.box_2d_data.point.x, box.box_2d_data.point.y + box.box_2d_data.size.y),
-		.p2 = vec2(box.box_2d_data.point.x, box.box_2d_data.point.y),
-		.color = box.box_2d_data.color
+	if(g_RendererState.software) {
+		for(size_t i=0; i<count; i++)
+			g_RendererState.software->addSprite(sprites[i]);
+		return;
+	}
+
+	size_t submitted = g_RendererState.sprite_batch->addRange(sprites, count);
+	while(submitted < count) {
+		flush_sprite_batch();
+		submitted += g_RendererState.sprite_batch->addRange(sprites + submitted, count - submitted);
+	}
+}
+
+static void open_sprite_run(SpriteStream& stream, uint8_t layer, float depth)
+{
+	std::vector<SpriteRun>& runs = stream.runs;
+	if(!runs.empty() && runs.back().layer == layer && runs.back().depth == depth)
+		return;
+
+	uint32_t first = uint32_t(stream.instances.size());
+	if(!runs.empty() && runs.back().first == first)
+		runs.pop_back();
+	runs.push_back({ first, layer, depth });
+}
+
+static void stream_add_sprite(SpriteStream& stream, float x, float y, float w, float h, 
+                              const Color& color, int tex, 
+                              float uvx1, float uvy1, float uvx2, float uvy2)
+{
+	open_sprite_run(stream, stream.layer, stream.depth);
+
+	stream.instances.push_back({
+		.position = vec2(x, y),
+		.size = vec2(w, h),
+		.uvmin = vec2(uvx1, uvy1),
+		.uvmax = vec2(uvx2, uvy2),
+		.color = vec4(color.r, color.g, color.b, color.a),
+		.texid = float(tex)
+	});
+}
+
+static Sprite* stream_push_sprites(SpriteStream& stream, size_t count)
+{
+	open_sprite_run(stream, stream.layer, stream.depth);
+
+	size_t first = stream.instances.size();
+	stream.instances.resize(first + count);
+	return stream.instances.data() + first;
+}
+
+static void stream_clear(SpriteStream& stream)
+{
+	stream.instances.clear();
+	stream.runs.clear();
+}
+
+// Copies src's sprites to the end of dst, keeping their runs.
+static void stream_copy(SpriteStream& dst, const SpriteStream& src)
+{
+	for(size_t r=0; r<src.runs.size(); r++) {
+		size_t first = src.runs[r].first;
+		size_t last = (r + 1 < src.runs.size()) ? src.runs[r + 1].first : src.instances.size();
+
+		open_sprite_run(dst, src.runs[r].layer, src.runs[r].depth);
+		dst.instances.insert(dst.instances.end(), 
+		                     src.instances.begin() + first, src.instances.begin() + last);
+	}
+}
+
+// Moves src's sprites to the end of dst, keeping their runs.
+static void stream_append(SpriteStream& dst, SpriteStream& src)
+{
+	stream_copy(dst, src);
+	stream_clear(src);
+}
+
+static DrawCommand make_line_command(float x1, float y1, float x2, float y2, const Color& color,
+                                     float width)
+{
+	DrawCommand command (DrawCommandType::LINE2D);
+
+	command.line_2d_data.p1    = vec2(x1, y1);
+	command.line_2d_data.p2    = vec2(x2, y2);
+	command.line_2d_data.color = color;
+	command.line_2d_data.width = width;
+	return command;
+}
+
+static DrawCommand make_box_command(float x, float y, float w, float h, const Color& color,
+                                    float width)
+{
+	DrawCommand command (DrawCommandType::BOX2D);
+
+	command.box_2d_data.point = vec2(x, y);
+	command.box_2d_data.size = vec2(w, h);
+	command.box_2d_data.color = color;
+	command.box_2d_data.width = width;
+	return command;
+}
+
+// Folds submitted lists into the global state, ordered by their submit
+// order so the result does not depend on which thread finished first.
+static void merge_submitted_lists(RenderList& target)
+{
+	std::lock_guard<std::mutex> lock(g_RendererState.submit_mutex);
+	std::vector<SubmittedList>& lists = g_RendererState.submitted_lists;
+
+	std::stable_sort(lists.begin(), lists.end(), 
+		[](const SubmittedList& a, const SubmittedList& b) { return a.order < b.order; });
+
+	for(const SubmittedList& submitted : lists) {
+		DrawCommand command;
+		while(submitted.list->line_commands.pop_front(command)) {
+			target.line_commands.push_command(command);
+		}
+		stream_append(target.sprites, submitted.list->sprites);
+	}
+
+	lists.clear();
+}
+
+// World-space bounds of what an orthographic camera can see. Rotated cameras
+// get the bounding box of their view, so culling stays conservative.
+static CullRect camera_cull_rect(const Camera& camera)
+{
+	CullRect rect;
+	rect.enabled = camera.orthographic;
+	if(!rect.enabled) return rect;
+
+	vec3 position = camera.transform.getGlobalPosition();
+	vec3 right = camera.transform.right();
+	vec3 up = camera.transform.up();
+
+	const float xs[2] = { camera.orthographicProperties.left, camera.orthographicProperties.right };
+	const float ys[2] = { camera.orthographicProperties.bottom, camera.orthographicProperties.top };
+
+	rect.min = vec2(INFINITY);
+	rect.max = vec2(-INFINITY);
+	for(float x : xs) {
+		for(float y : ys) {
+			vec3 corner = position + right * x + up * y;
+			rect.min = MIN(rect.min, vec2(corner.x, corner.y));
+			rect.max = MAX(rect.max, vec2(corner.x, corner.y));
+		}
+	}
+
+	return rect;
+}
+
+static bool rect_visible(const CullRect& view, vec2 a, vec2 b)
+{
+	return MIN(a.x, b.x) <= view.max.x && MAX(a.x, b.x) >= view.min.x &&
+	       MIN(a.y, b.y) <= view.max.y && MAX(a.y, b.y) >= view.min.y;
+}
+
+static bool line_command_visible(const CullRect& view, const DrawCommand& command)
+{
+	if(!view.enabled) return true;
+
+	switch (command.type)
+	{
+		case DrawCommandType::LINE2D:
+		{
+			vec2 a = command.line_2d_data.p1, b = command.line_2d_data.p2;
+			vec2 pad(command.line_2d_data.width * 0.5f);
+			return rect_visible(view, MIN(a, b) - pad, MAX(a, b) + pad);
+		}
+		case DrawCommandType::BOX2D:
+		{
+			vec2 a = command.box_2d_data.point, b = a + command.box_2d_data.size;
+			vec2 pad(command.box_2d_data.width * 0.5f);
+			return rect_visible(view, MIN(a, b) - pad, MAX(a, b) + pad);
+		}
+		default:
+			return true;
+	}
+}
+
+#ifdef RENDERER_SIMD_CULL
+// Visibility bits for sprites[0..3], one bit per sprite.
+static int sprite_visibility_mask4(const CullRect& view, const Sprite* s)
+{
+	__m128 px = _mm_setr_ps(s[0].position.x, s[1].position.x, s[2].position.x, s[3].position.x);
+	__m128 py = _mm_setr_ps(s[0].position.y, s[1].position.y, s[2].position.y, s[3].position.y);
+	__m128 ex = _mm_add_ps(px, _mm_setr_ps(s[0].size.x, s[1].size.x, s[2].size.x, s[3].size.x));
+	__m128 ey = _mm_add_ps(py, _mm_setr_ps(s[0].size.y, s[1].size.y, s[2].size.y, s[3].size.y));
+
+	__m128 inside = _mm_and_ps(
+		_mm_and_ps(_mm_cmple_ps(_mm_min_ps(px, ex), _mm_set1_ps(view.max.x)),
+		           _mm_cmpge_ps(_mm_max_ps(px, ex), _mm_set1_ps(view.min.x))),
+		_mm_and_ps(_mm_cmple_ps(_mm_min_ps(py, ey), _mm_set1_ps(view.max.y)),
+		           _mm_cmpge_ps(_mm_max_ps(py, ey), _mm_set1_ps(view.min.y))));
+
+	return _mm_movemask_ps(inside);
+}
+#endif
+
+// Compacts the stream down to the sprites that overlap the view, keeping
+// run boundaries in step. Returns the number of sprites removed.
+static size_t cull_sprites(SpriteStream& stream, const CullRect& view)
+{
+	if(!view.enabled) return 0;
+
+	std::vector<Sprite>& sprites = stream.instances;
+	const size_t count = sprites.size();
+	size_t write = 0;
+
+	for(size_t r=0; r<stream.runs.size(); r++) {
+		size_t i = stream.runs[r].first;
+		size_t last = (r + 1 < stream.runs.size()) ? stream.runs[r + 1].first : count;
+		stream.runs[r].first = uint32_t(write);
+
+#ifdef RENDERER_SIMD_CULL
+		for(; i + 4 <= last; i += 4) {
+			int mask = sprite_visibility_mask4(view, &sprites[i]);
+			for(int lane=0; lane<4; lane++) {
+				if(mask & (1 << lane))
+					sprites[write++] = sprites[i + lane];
+			}
+		}
+#endif
+		for(; i < last; i++) {
+			if(rect_visible(view, sprites[i].position, sprites[i].position + sprites[i].size))
+				sprites[write++] = sprites[i];
+		}
+	}
+
+	sprites.resize(write);
+	return count - write;
+}
+
+// Builds one sort key per submitted sprite, returns false when they are
+// not already in key order.
+static bool build_sprite_keys(std::vector<SortEntry>& entries)
+{
+	const std::vector<Sprite>& sprites = g_RendererState.draw_frame->commands.sprites.instances;
+	const std::vector<SpriteRun>& runs = g_RendererState.draw_frame->commands.sprites.runs;
+
+	entries.resize(sprites.size());
+	bool in_order = true;
+	uint64_t previous = 0;
+
+	for(size_t r=0; r<runs.size(); r++) {
+		size_t last = (r + 1 < runs.size()) ? runs[r + 1].first : sprites.size();
+		for(size_t i=runs[r].first; i<last; i++) {
+			uint64_t key = make_sort_key(runs[r].layer, runs[r].depth);
+			in_order = in_order && key >= previous;
+			previous = key;
+			entries[i] = { key, uint32_t(i) };
+		}
+	}
+
+	return in_order;
+}
+
+// Texture to bind in place of `id`, the fallback while its upload is pending.
+static unsigned int resolve_texture(unsigned int id)
+{
+	TextureUploader* uploader = g_RendererState.uploader;
+	if(!id || !uploader || !uploader->isPending(id))
+		return id;
+
+	unsigned int fallback = g_RendererState.fallback_texture.id;
+	return fallback ? fallback : g_RendererState.white_texture.id;
+}
+
+static CameraUniforms get_camera_uniforms(const Shader& shader)
+{
+	return CameraUniforms {
+		.proj = shader_get_uniform(shader, "uProj"),
+		.view = shader_get_uniform(shader, "uView"),
 	};
-	add_line_2d(l);
 }
 
-void renderer_init(const Window* window) {
-	if(g_RendererState.initialized) {
-		std::cout << "Renderer already initialized\n";
+static void upload_camera(const Shader& shader, const CameraUniforms& uniforms, const Camera& camera)
+{
+	shader_upload_mat4(shader, uniforms.proj, camera.proj.elements);
+	shader_upload_mat4(shader, uniforms.view, camera.view.elements);
+}
+
+static void create_render_target(RenderTarget& target, int width, int height)
+{
+	target.width = width;
+	target.height = height;
+
+	glGenTextures(1, &target.color);
+	gl_bind_texture(0, GL_TEXTURE_2D, target.color);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+
+	glGenFramebuffers(1, &target.fbo);
+	gl_bind_framebuffer(GL_FRAMEBUFFER, target.fbo);
+	glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, target.color, 0);
+
+	if(glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+		std::cout << "Render target " << width << "x" << height << " is incomplete\n";
+}
+
+static void destroy_render_target(RenderTarget& target)
+{
+	if(!target.fbo) return;
+
+	gl_delete_framebuffer(target.fbo);
+	gl_delete_texture(target.color);
+	target = {};
+}
+
+//======================================================================//
+//                           SOFTWARE BACKEND                           //
+//======================================================================//
+
+static SoftwareTexture* software_texture(unsigned int id)
+{
+	if(!g_RendererState.software || id == 0 || id > g_RendererState.software_textures.size())
+		return nullptr;
+	return g_RendererState.software_textures[id - 1];
+}
+
+// Expands to RGBA8 the way GL does for missing channels (green/blue 0, alpha 1).
+static void fill_software_texture(SoftwareTexture& texture, const unsigned char* data, 
+                                  int width, int height, int channels, TextureSpec spec)
+{
+	texture.width = width;
+	texture.height = height;
+	texture.linear = (spec & TEXTURESPEC_LINEAR) != 0;
+	texture.clip = (spec & TEXTURESPEC_CLIP) != 0;
+	texture.texels.resize(size_t(width) * height);
+
+	for(size_t i=0; i<texture.texels.size(); i++) {
+		const unsigned char* texel = data + i * channels;
+		uint32_t r = texel[0];
+		uint32_t g = channels > 1 ? texel[1] : 0;
+		uint32_t b = channels > 2 ? texel[2] : 0;
+		uint32_t a = channels > 3 ? texel[3] : 255;
+		texture.texels[i] = r | (g << 8) | (b << 16) | (a << 24);
+	}
+}
+
+static Texture2D software_load_texture(const unsigned char* data, int width, int height, 
+                                       int channels, TextureSpec spec)
+{
+	SoftwareTexture* texture = new SoftwareTexture;
+	fill_software_texture(*texture, data, width, height, channels, spec);
+
+	std::vector<SoftwareTexture*>& textures = g_RendererState.software_textures;
+	auto it = std::find(textures.begin(), textures.end(), nullptr);
+	if(it == textures.end())
+		it = textures.insert(textures.end(), nullptr);
+	*it = texture;
+
+	return Texture2D { unsigned(it - textures.begin()) + 1 };
+}
+
+static void software_delete_texture(unsigned int id)
+{
+	if(!software_texture(id)) return;
+
+	delete g_RendererState.software_textures[id - 1];
+	g_RendererState.software_textures[id - 1] = nullptr;
+}
+
+// Copies the CPU frame into the render target, which renderer_blit() then
+// scales to the window like a GL rendered frame.
+static void upload_software_frame()
+{
+	const SoftwareRasterizer* software = g_RendererState.software;
+	RenderTarget& target = g_RendererState.target;
+
+	const int width = software->getWidth(), height = software->getHeight();
+	if(width <= 0 || height <= 0) {
+		destroy_render_target(target);
 		return;
 	}
 
+	if(!target.fbo || target.width != width || target.height != height) {
+		destroy_render_target(target);
+		create_render_target(target, width, height);
+	}
+
+	gl_bind_texture(0, GL_TEXTURE_2D, target.color);
+	glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, width, height, 
+	                GL_RGBA, GL_UNSIGNED_INT_8_8_8_8_REV, software->getPixels());
+}
+
+//======================================================================//
+//                              INITIALIZE                              //
+//======================================================================//
+
+static bool init_software_backend()
+{
+	// GL is only needed to put the CPU frame on screen
+	if(!g_RendererState.headless && !gladLoadGLLoader((GLADloadproc)glfwGetProcAddress)) {
+		std::cout << "Failed to initialize GLAD\n";
+		return false;
+	}
+
+	g_RendererState.software = new SoftwareRasterizer();
+	g_RendererState.bind_slot_max = SoftwareRasterizer::TEXTURE_SLOTS;
+	profiler_init(false);
+
+	std::cout << "Software Renderer: " << std::max(1u, std::thread::hardware_concurrency()) 
+	          << " threads" << std::endl;
+	return true;
+}
+
+static bool init_opengl_backend()
+{
 	if(!gladLoadGLLoader((GLADloadproc)glfwGetProcAddress)) {
 		std::cout << "Failed to initialize GLAD\n";
-		return;
+		return false;
 	}
 
 	std::cout << "OpenGL Renderer: " << glGetString(GL_RENDERER) << std::endl;
@@ -171,11 +738,13 @@ void renderer_init(const Window* window) {
 	std::cout << "OpenGL Version: " << glGetString(GL_VERSION) << std::endl;
 	std::cout << "GLSL Version: " << glGetString(GL_SHADING_LANGUAGE_VERSION) << std::endl;
 
-	glEnable(GL_BLEND);
-	glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+	profiler_init();
+	gl_set_blend(true);
+	gl_blend_func(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
 
 	g_RendererState.line_batch_2d = new LineBatch2D(1024);
 	g_RendererState.sprite_batch  = new SpriteBatch();
+	g_RendererState.uploader      = new TextureUploader(RNL_UPLOAD_BUDGET);
 
 	shader_load_glsl_from_source(LINE2D_SHADER_SOURCE_V, 
 															LINE2D_SHADER_SOURCE_F, 
@@ -195,7 +764,49 @@ void renderer_init(const Window* window) {
 	shader_use_program(g_RendererState.sprite_shader);
 	shader_upload_int_array(g_RendererState.sprite_shader, "uTextures", 
 												 texture_slots, g_RendererState.bind_slot_max);
+	shader_load_glsl_from_source(SPRITE_SHADER_SOURCE_V,
+	                             SPRITE_ARRAY_SHADER_SOURCE_F,
+	                             g_RendererState.sprite_array_shader);
+	shader_use_program(g_RendererState.sprite_array_shader);
+	shader_upload_int(g_RendererState.sprite_array_shader, "uTextureArray", 0);
+
+	shader_load_glsl_from_source(TILEMAP_SHADER_SOURCE_V,
+	                             TILEMAP_SHADER_SOURCE_F,
+	                             g_RendererState.tilemap_shader);
+	shader_use_program(g_RendererState.tilemap_shader);
+	shader_upload_int(g_RendererState.tilemap_shader, "uTileset", 0);
+	shader_upload_int(g_RendererState.tilemap_shader, "uTileIndices", 1);
+
+	g_RendererState.line_uniforms = get_camera_uniforms(g_RendererState.line_shader);
+	g_RendererState.sprite_uniforms = get_camera_uniforms(g_RendererState.sprite_shader);
+	g_RendererState.sprite_array_uniforms = get_camera_uniforms(g_RendererState.sprite_array_shader);
+
+	const Shader& tilemap = g_RendererState.tilemap_shader;
+	g_RendererState.tilemap_uniforms = {
+		.camera       = get_camera_uniforms(tilemap),
+		.tile_pixels  = shader_get_uniform(tilemap, "uTilePixels"),
+		.chunk_origin = shader_get_uniform(tilemap, "uChunkOrigin"),
+		.chunk_size   = shader_get_uniform(tilemap, "uChunkSize"),
+		.chunk_tiles  = shader_get_uniform(tilemap, "uChunkTiles"),
+	};
+
 	shader_use_program({0});
+	return true;
+}
+
+void renderer_init(const Window* window, RendererBackend backend) {
+	if(g_RendererState.initialized) {
+		std::cout << "Renderer already initialized\n";
+		return;
+	}
+
+	std::tie(g_RendererState.window_width, g_RendererState.window_height) = window_get_resolution(window);
+	g_RendererState.headless = window_is_headless(window);
+	gl_state_invalidate();
+
+	bool ready = (backend == RENDERER_BACKEND_SOFTWARE) ? init_software_backend() 
+	                                                     : init_opengl_backend();
+	if(!ready) return;
  
 	{
 		Image2D* white = image_initialize(1,1,3);
@@ -208,39 +819,105 @@ void renderer_init(const Window* window) {
 		g_RendererState.white_texture = renderer_load_texture(white, TEXTURESPEC_NONE);
 		image_free(white);
 	}
+
+	g_RendererState.initialized = true;
+}
+
+void renderer_set_sprite_format(SpriteFormat format)
+{
+	if(g_RendererState.software || g_RendererState.sprite_batch->getFormat() == format) return;
+
+	delete g_RendererState.sprite_batch;
+	g_RendererState.sprite_batch = new SpriteBatch(format);
 }
 
 void renderer_set_viewport(int x, int y) 
 {
-	glViewport(0, 0, x, y);
+	if(g_RendererState.pipelined) {
+		g_RendererState.record_frame->viewport_width = x;
+		g_RendererState.record_frame->viewport_height = y;
+		return;
+	}
+
+	g_RendererState.window_width = x;
+	g_RendererState.window_height = y;
+	if(!g_RendererState.software)
+		glViewport(0, 0, x, y);
 }
 
 void renderer_cleanup() 
 {
+	// takes the GL context back from the render thread once it has drawn
+	// everything queued, only then can resources go
+	renderer_pipeline_stop();
+
 	renderer_delete_texture(g_RendererState.white_texture);
-	
-	g_RendererState.line_command_buffer.clear();
-	g_RendererState.sprite_command_buffer.clear();
+
+	for(const WatchedTexture& texture : g_RendererState.watched_textures)
+		file_watch_remove(texture.watch);
+	g_RendererState.watched_textures.clear();
+
+	for(FrameSlot& frame : g_RendererState.frames) {
+		frame.commands.line_commands.clear();
+		stream_clear(frame.commands.sprites);
+	}
+	g_RendererState.submitted_lists.clear();
 
 	delete g_RendererState.line_batch_2d;
 	delete g_RendererState.sprite_batch;
+	delete g_RendererState.uploader;
+	g_RendererState.uploader = nullptr;
 
-	shader_delete_program(g_RendererState.line_shader);
-	shader_delete_program(g_RendererState.sprite_shader);
+	destroy_render_target(g_RendererState.target);
+	profiler_shutdown();
+
+	if(g_RendererState.software) {
+		for(SoftwareTexture* texture : g_RendererState.software_textures)
+			delete texture;
+		g_RendererState.software_textures.clear();
+
+		delete g_RendererState.software;
+		g_RendererState.software = nullptr;
+	}
+	else {
+		shader_delete_program(g_RendererState.line_shader);
+		shader_delete_program(g_RendererState.sprite_shader);
+		shader_delete_program(g_RendererState.sprite_array_shader);
+		shader_delete_program(g_RendererState.tilemap_shader);
+	}
 
 	g_RendererState.initialized = false;
 }
 
 void renderer_draw_lines(const Camera& camera) 
 {
-	shader_use_program(g_RendererState.line_shader);
-	shader_upload_mat4(g_RendererState.line_shader, "uProj", camera.proj.elements);
-	shader_upload_mat4(g_RendererState.line_shader, "uView", camera.view.elements);
+	ProfileScope scope(PROFILE_PASS_LINES);
+	SoftwareRasterizer* software = g_RendererState.software;
 
-	g_RendererState.line_batch_2d->begin();
+	if(software) {
+		software->setCamera(camera.proj, camera.view);
+	}
+	else {
+		shader_use_program(g_RendererState.line_shader);
+		upload_camera(g_RendererState.line_shader, g_RendererState.line_uniforms, camera);
+		g_RendererState.line_batch_2d->begin();
+	}
+
+	RenderList& commands = g_RendererState.draw_frame->commands;
+	if(!g_RendererState.pipelined)
+		merge_submitted_lists(commands);
+
+	const CullRect view = camera_cull_rect(camera);
+	size_t drawn = 0, culled = 0;
 
 	DrawCommand line_command;
-	while(g_RendererState.line_command_buffer.pop_front(line_command)) {
+	while(commands.line_commands.pop_front(line_command)) {
+		if(!line_command_visible(view, line_command)) {
+			culled++;
+			continue;
+		}
+
+		drawn++;
 		switch (line_command.type)
 		{
 			case DrawCommandType::LINE2D:
@@ -254,111 +931,284 @@ void renderer_draw_lines(const Camera& camera)
 		}
 	}
 
-	g_RendererState.line_batch_2d->end();
-	g_RendererState.line_batch_2d->drawBatch();
+	if(software) {
+		software->flush();
+	}
+	else {
+		g_RendererState.line_batch_2d->end();
+		g_RendererState.line_batch_2d->drawBatch();
+	}
+
+	g_RendererState.lines_drawn = drawn;
+	g_RendererState.lines_culled = culled;
 }
 
-void renderer_draw_sprites(const Camera& camera) 
+// Texture the sprite pass binds to `slot`, slot 0 is always the white texture.
+static unsigned int slot_texture(const FrameSlot& frame, int slot)
 {
+	return slot == 0 ? g_RendererState.white_texture.id : frame.texture_slots[slot];
+}
 
-	shader_use_program(g_RendererState.sprite_shader);
-	shader_upload_mat4(g_RendererState.sprite_shader, "uProj", camera.proj.elements);
-	shader_upload_mat4(g_RendererState.sprite_shader, "uView", camera.view.elements);
+// Sprite program, camera and texture bindings shared by every sprite draw.
+// Reads the drawn frame's bindings only, the recording thread owns the rest.
+static void bind_sprite_pass(const Camera& camera)
+{
+	const FrameSlot& frame = *g_RendererState.draw_frame;
 
-	renderer_bind_texture_slot(g_RendererState.white_texture, 0);
+	if(SoftwareRasterizer* software = g_RendererState.software) {
+		software->setCamera(camera.proj, camera.view);
 
-	for(size_t i=0; i<g_RendererState.bind_slot_max; i++) {
-		glActiveTexture(GL_TEXTURE0 + i);
-		glBindTexture(GL_TEXTURE_2D, g_RendererState.texture_slots[i]);
+		for(int i=0; i<g_RendererState.bind_slot_max; i++)
+			software->setTexture(i, software_texture(slot_texture(frame, i)));
+		return;
 	}
 
-	g_RendererState.sprite_batch->begin();
+	const TextureArray& texture_array = frame.texture_array;
+	const Shader& shader = texture_array.id ? g_RendererState.sprite_array_shader 
+	                                        : g_RendererState.sprite_shader;
+	const CameraUniforms& uniforms = texture_array.id ? g_RendererState.sprite_array_uniforms 
+	                                                  : g_RendererState.sprite_uniforms;
+
+	shader_use_program(shader);
+	upload_camera(shader, uniforms, camera);
 
-	DrawCommand sprite_command;
-	while(g_RendererState.sprite_command_buffer.pop_front(sprite_command)) {
-		add_sprite(sprite_command);
+	if(texture_array.id) {
+		gl_bind_texture(0, GL_TEXTURE_2D_ARRAY, texture_array.id);
 	}
+	else {
+		for(int i=0; i<g_RendererState.bind_slot_max; i++) {
+			gl_bind_texture(i, GL_TEXTURE_2D, resolve_texture(slot_texture(frame, i)));
+		}
+	}
+}
 
-	g_RendererState.sprite_batch->end();
-	g_RendererState.sprite_batch->drawBatch();
+void renderer_draw_sprites(const Camera& camera) 
+{
+	ProfileScope scope(PROFILE_PASS_SPRITES);
+	bind_sprite_pass(camera);
+
+	RenderList& commands = g_RendererState.draw_frame->commands;
+	if(!g_RendererState.pipelined)
+		merge_submitted_lists(commands);
+
+	SoftwareRasterizer* software = g_RendererState.software;
+	if(!software)
+		g_RendererState.sprite_batch->begin();
+
+	g_RendererState.sprites_culled = cull_sprites(commands.sprites, camera_cull_rect(camera));
+	g_RendererState.sprites_drawn = commands.sprites.instances.size();
+
+	std::vector<Sprite>& sprites = commands.sprites.instances;
+	std::vector<SortEntry>& entries = g_RendererState.sprite_sort_entries;
+
+	if(build_sprite_keys(entries)) {
+		add_sprite_range(sprites.data(), sprites.size());
+	}
+	else {
+		radix_sort(entries, g_RendererState.sprite_sort_scratch);
+		for(const SortEntry& entry : entries) {
+			add_sprite(sprites[entry.index]);
+		}
+	}
+
+	if(software) {
+		software->flush();
+	}
+	else {
+		g_RendererState.sprite_batch->end();
+		g_RendererState.sprite_batch->drawBatch();
+	}
+
+	stream_clear(commands.sprites);
 
 }
 
 void renderer_clear_buffer(float r, float g, float b, float a) 
 {
+	ProfileScope scope(PROFILE_PASS_CLEAR);
+	if(g_RendererState.software) {
+		g_RendererState.software->clear(vec4(r, g, b, a));
+		return;
+	}
+
 	glClearColor(r, g, b, a);
 	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 }
 
 void renderer_clear_buffer(float color[4]) 
 {
-	glClearColor(color[0], color[1], color[2], color[3]);
-	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+	renderer_clear_buffer(color[0], color[1], color[2], color[3]);
 }
 
 void renderer_add_line2d(float x1, float y1, 
 												 float x2, float y2, 
-												 const Color& color) 
+												 const Color& color, float width) 
 {
-	DrawCommand command (DrawCommandType::LINE2D);
+	g_RendererState.record_frame->commands.line_commands.push_command(make_line_command(x1, y1, x2, y2, color, width));
+}
 
-	command.line_2d_data.p1    = vec2(x1, y1);
-	command.line_2d_data.p2    = vec2(x2, y2);
-	command.line_2d_data.color = color;
+void renderer_add_box2d(float x, float y, float w, float h, const Color& color, float width)
+{
+	g_RendererState.record_frame->commands.line_commands.push_command(make_box_command(x, y, w, h, color, width));
+}
 
-	g_RendererState.line_command_buffer.push_command(command);
+void renderer_add_sprite(float x, float y, float w, float h, const Color& color,
+												 int tex, float uvx1, float uvy1, float uvx2, float uvy2)
+{
+	stream_add_sprite(g_RendererState.record_frame->commands.sprites, x, y, w, h, color, tex, uvx1, uvy1, uvx2, uvy2);
 }
 
-void renderer_add_box2d(float x, float y, float w, float h, const Color& color)
+Sprite* renderer_push_sprites(size_t count)
 {
-	DrawCommand command (DrawCommandType::BOX2D);
+	return stream_push_sprites(g_RendererState.record_frame->commands.sprites, count);
+}
 
-	command.box_2d_data.point = vec2(x, y);
-	command.box_2d_data.size = vec2(w, h);
-	command.box_2d_data.color = color;
+void renderer_set_sprite_layer(uint8_t layer, float depth)
+{
+	g_RendererState.record_frame->commands.sprites.layer = layer;
+	g_RendererState.record_frame->commands.sprites.depth = depth;
+}
 
-	g_RendererState.line_command_buffer.push_command(command);
+RenderList* renderer_create_list()
+{
+	return new RenderList;
 }
 
-void renderer_add_sprite(float x, float y, float w, float h, const Color& color,
-												 int tex, float uvx1, float uvy1, float uvx2, float uvy2)
+void renderer_destroy_list(RenderList* list)
 {
-	DrawCommand command(DrawCommandType::SPRITE);
+	delete list;
+}
 
-	command.sprite_data = {
-		vec2(x, y),
-		vec2(w, h),
-		vec2(uvx1, uvy1),
-		vec2(uvx2, uvy2),
-		tex,
-		color
-	};
+void renderer_list_add_line2d(RenderList* list, float x1, float y1, float x2, float y2, 
+                              const Color& color, float width)
+{
+	list->line_commands.push_command(make_line_command(x1, y1, x2, y2, color, width));
+}
+
+void renderer_list_add_box2d(RenderList* list, float x, float y, float w, float h, 
+                             const Color& color, float width)
+{
+	list->line_commands.push_command(make_box_command(x, y, w, h, color, width));
+}
+
+void renderer_list_add_sprite(RenderList* list, float x, float y, float w, float h, 
+                              const Color& color, int tex, 
+                              float uvx1, float uvy1, float uvx2, float uvy2)
+{
+	stream_add_sprite(list->sprites, x, y, w, h, color, tex, uvx1, uvy1, uvx2, uvy2);
+}
 
-	g_RendererState.sprite_command_buffer.push_command(command);
+Sprite* renderer_list_push_sprites(RenderList* list, size_t count)
+{
+	return stream_push_sprites(list->sprites, count);
+}
+
+void renderer_list_set_sprite_layer(RenderList* list, uint8_t layer, float depth)
+{
+	list->sprites.layer = layer;
+	list->sprites.depth = depth;
+}
+
+void renderer_submit_list(RenderList* list, uint32_t order)
+{
+	std::lock_guard<std::mutex> lock(g_RendererState.submit_mutex);
+	g_RendererState.submitted_lists.push_back({ order, list });
+}
+
+StaticSpriteBatch* renderer_create_static_layer(const Sprite* sprites, size_t count)
+{
+	if(g_RendererState.software) return nullptr;
+	return new StaticSpriteBatch(sprites, count, g_RendererState.sprite_batch->getFormat());
+}
+
+void renderer_destroy_static_layer(StaticSpriteBatch* layer)
+{
+	delete layer;
+}
+
+void renderer_draw_static_layer(StaticSpriteBatch* layer, const Camera& camera)
+{
+	if(!layer) return;
+
+	bind_sprite_pass(camera);
+	layer->drawBatch();
+}
+
+void renderer_draw_tilemap(Tilemap* map, Texture2D tileset, int tile_pixels, const Camera& camera)
+{
+	if(!map || g_RendererState.software) return;
+
+	ProfileScope scope(PROFILE_PASS_TILEMAP);
+	map->upload();
+
+	const Shader& shader = g_RendererState.tilemap_shader;
+	const TilemapUniforms& uniforms = g_RendererState.tilemap_uniforms;
+	shader_use_program(shader);
+	upload_camera(shader, uniforms.camera, camera);
+	shader_upload_int(shader, uniforms.tile_pixels, tile_pixels);
+
+	gl_bind_texture(0, GL_TEXTURE_2D, resolve_texture(tileset.id));
+
+	const CullRect view = camera_cull_rect(camera);
+	for(size_t i=0; i<map->getChunkCount(); i++) {
+		vec2 min, size, tiles;
+		map->getChunkBounds(i, min, size, tiles);
+		if(view.enabled && !rect_visible(view, min, min + size))
+			continue;
+
+		shader_upload_vec2(shader, uniforms.chunk_origin, min.x, min.y);
+		shader_upload_vec2(shader, uniforms.chunk_size, size.x, size.y);
+		shader_upload_vec2(shader, uniforms.chunk_tiles, tiles.x, tiles.y);
+		map->drawChunk(i, 1);
+	}
+}
+
+RendererStats renderer_get_stats()
+{
+	RendererStats stats;
+	stats.sprites_drawn = g_RendererState.sprites_drawn;
+	stats.sprites_culled = g_RendererState.sprites_culled;
+	stats.lines_drawn = g_RendererState.lines_drawn;
+	stats.lines_culled = g_RendererState.lines_culled;
+
+	GLStateStats gl_stats = gl_state_get_stats();
+	stats.gl_calls_issued = gl_stats.issued;
+	stats.gl_calls_skipped = gl_stats.skipped;
+	return stats;
 }
 
 void renderer_bind_texture_slot(Texture2D texture, int slot) {
 	if (slot <  g_RendererState.bind_slot_max) {
-		g_RendererState.texture_slots[slot] = texture.id;
+		g_RendererState.record_frame->texture_slots[slot] = texture.id;
 	}
 }
 
 void renderer_clear_line_buffer() 
 {
-	g_RendererState.line_command_buffer.clear();
+	g_RendererState.record_frame->commands.line_commands.clear();
 }
 
 void renderer_clear_sprite_buffer() {
-	g_RendererState.sprite_command_buffer.clear();
+	stream_clear(g_RendererState.record_frame->commands.sprites);
 }
 
-Texture2D renderer_load_texture(Image2D* image, TextureSpec spec) {
-	if(!image || !image_get_data(image))
-		return Texture2D {0};
+static void get_image_size(const Image2D* image, int& width, int& height, int& channels)
+{
+	float data;
+	image_get_specification(image, ImageSpec::NUM_CHANNELS, data);
+	channels = int(data);
+	image_get_specification(image, ImageSpec::WIDTH, data);
+	width = int(data);
+	image_get_specification(image, ImageSpec::HEIGHT, data);
+	height = int(data);
+}
 
-	Texture2D texture;
-	glGenTextures(1, &texture.id);
-	glBindTexture(GL_TEXTURE_2D, texture.id);
+// (Re)specifies texture `id`. With `async` it only gets its storage here and
+// the uploader fills it in over the next frames.
+static void specify_texture(unsigned int id, const unsigned char* pixels, int width, int height,
+                            int channels, TextureSpec spec, bool async)
+{
+	gl_bind_texture(0, GL_TEXTURE_2D, id);
 
 	GLint filter = (spec & TEXTURESPEC_LINEAR) ? GL_LINEAR : GL_NEAREST;
 	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, filter);
@@ -367,18 +1217,6 @@ Texture2D renderer_load_texture(Image2D* image, TextureSpec spec) {
 	GLint wrap = (spec & TEXTURESPEC_CLIP) ? GL_CLAMP_TO_EDGE : GL_REPEAT;
 	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, wrap);
 	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, wrap);
-	
-	int channels, width, height;
-
-	{
-		float data;
-		image_get_specification(image, ImageSpec::NUM_CHANNELS, data);
-		channels = int(data);
-		image_get_specification(image, ImageSpec::WIDTH, data);
-		width = int(data);
-		image_get_specification(image, ImageSpec::HEIGHT, data);
-		height = int(data);
-	}
 
 	GLenum format = (channels == 4) ? GL_RGBA :
 		(channels == 3) ? GL_RGB  :
@@ -386,38 +1224,747 @@ Texture2D renderer_load_texture(Image2D* image, TextureSpec spec) {
 		GL_RED;
 
 	glTexImage2D(GL_TEXTURE_2D, 0, format, width, height, 0, 
-							format, GL_UNSIGNED_BYTE, image_get_data(image));
-	glGenerateMipmap(GL_TEXTURE_2D);
+							format, GL_UNSIGNED_BYTE, async ? nullptr : pixels);
+
+	if(async)
+		g_RendererState.uploader->queue(id, pixels, width, height, channels);
+	else
+		glGenerateMipmap(GL_TEXTURE_2D);
+}
 
-	glBindTexture(GL_TEXTURE_2D, 0);
+static Texture2D load_texture(Image2D* image, TextureSpec spec, bool async) {
+	if(!image || !image_get_data(image))
+		return Texture2D {0};
+
+	int channels, width, height;
+	get_image_size(image, width, height, channels);
 
+	if(g_RendererState.software)
+		return software_load_texture(image_get_data(image), width, height, channels, spec);
+
+	Texture2D texture;
+	glGenTextures(1, &texture.id);
+	specify_texture(texture.id, image_get_data(image), width, height, channels, spec, async);
 	return texture;
 }
 
+// A failed decode (e.g. the file caught mid-write) keeps the old contents.
+static void reload_texture(const char* path, void* user)
+{
+	const unsigned int id = unsigned(uintptr_t(user));
+	const std::vector<WatchedTexture>& watched = g_RendererState.watched_textures;
+
+	auto it = std::find_if(watched.begin(), watched.end(), 
+	                       [id](const WatchedTexture& texture) { return texture.id == id; });
+	if(it == watched.end()) return;
+
+	Image2D* image = image_load(path);
+	if(!image) {
+		std::cout << "Can't reload texture " << path << "\n";
+		return;
+	}
+
+	int channels, width, height;
+	get_image_size(image, width, height, channels);
+
+	if(SoftwareTexture* texture = software_texture(id)) {
+		fill_software_texture(*texture, image_get_data(image), width, height, channels, it->spec);
+	}
+	else {
+		if(g_RendererState.uploader)
+			g_RendererState.uploader->cancel(id);
+		specify_texture(id, image_get_data(image), width, height, channels, it->spec, false);
+	}
+
+	image_free(image);
+	std::cout << "Reloaded texture " << path << std::endl;
+}
+
+static void unwatch_texture(unsigned int id)
+{
+	std::vector<WatchedTexture>& watched = g_RendererState.watched_textures;
+	for(size_t i=0; i<watched.size(); i++) {
+		if(watched[i].id != id) continue;
+
+		file_watch_remove(watched[i].watch);
+		watched.erase(watched.begin() + i);
+		return;
+	}
+}
+
+Texture2D renderer_load_texture(Image2D* image, TextureSpec spec) {
+	return load_texture(image, spec, false);
+}
+
 Texture2D renderer_load_texture(const char* path, TextureSpec spec) {
 	Texture2D texture;
 	Image2D* image = image_load(path);
 	texture = renderer_load_texture(image, spec);
 	image_free(image);
+
+	if(texture.id) {
+		int watch = file_watch_add(path, reload_texture, (void*) uintptr_t(texture.id));
+		if(watch >= 0)
+			g_RendererState.watched_textures.push_back({ texture.id, spec, watch });
+	}
 	return texture;
 }
 
 void renderer_delete_texture(Texture2D& texture) {
-	glDeleteTextures(1, &texture.id);
+	unwatch_texture(texture.id);
+
+	if(g_RendererState.software) {
+		software_delete_texture(texture.id);
+	}
+	else {
+		if(g_RendererState.uploader)
+			g_RendererState.uploader->cancel(texture.id);
+		gl_delete_texture(texture.id);
+	}
 	texture.id = 0;
 }
 
+Texture2D renderer_load_texture_async(Image2D* image, TextureSpec spec) {
+	return load_texture(image, spec, g_RendererState.uploader != nullptr);
+}
+
+bool renderer_texture_ready(Texture2D texture) {
+	return !g_RendererState.uploader || !g_RendererState.uploader->isPending(texture.id);
+}
+
+void renderer_set_upload_budget(size_t bytes_per_frame) {
+	if(g_RendererState.uploader)
+		g_RendererState.uploader->setBudget(bytes_per_frame);
+}
+
+void renderer_set_fallback_texture(Texture2D texture) {
+	g_RendererState.fallback_texture = texture;
+}
+
+TextureArray renderer_load_texture_array(Image2D** images, int count, TextureSpec spec) {
+	TextureArray array { 0, 0, 0, 0 };
+	if(!images || count <= 0 || !images[0])
+		return array;
+
+	if(g_RendererState.software) {
+		std::cout << "Texture arrays need the OpenGL renderer\n";
+		return array;
+	}
+
+	{
+		float data;
+		image_get_specification(images[0], ImageSpec::WIDTH, data);
+		array.width = int(data);
+		image_get_specification(images[0], ImageSpec::HEIGHT, data);
+		array.height = int(data);
+	}
+
+	glGenTextures(1, &array.id);
+	gl_bind_texture(0, GL_TEXTURE_2D_ARRAY, array.id);
+	glTexStorage3D(GL_TEXTURE_2D_ARRAY, 1, GL_RGBA8, array.width, array.height, count);
+
+	GLint filter = (spec & TEXTURESPEC_LINEAR) ? GL_LINEAR : GL_NEAREST;
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, filter);
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, filter);
+
+	GLint wrap = (spec & TEXTURESPEC_CLIP) ? GL_CLAMP_TO_EDGE : GL_REPEAT;
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, wrap);
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, wrap);
+
+	Image2D* rgba = image_initialize(array.width, array.height, 4);
+	for(int layer=0; layer<count; layer++) {
+		float width = 0, height = 0, channels = 0;
+		image_get_specification(images[layer], ImageSpec::WIDTH, width);
+		image_get_specification(images[layer], ImageSpec::HEIGHT, height);
+		image_get_specification(images[layer], ImageSpec::NUM_CHANNELS, channels);
+
+		if(int(width) != array.width || int(height) != array.height) {
+			std::cout << "Texture array layer " << layer << " is " << width << "x" << height 
+			          << ", expected " << array.width << "x" << array.height << "\n";
+			continue;
+		}
+
+		const Image2D* source = images[layer];
+		if(int(channels) != 4) {
+			image_blit(rgba, source, 0, 0);
+			source = rgba;
+		}
+
+		glTexSubImage3D(GL_TEXTURE_2D_ARRAY, 0, 0, 0, layer, array.width, array.height, 1,
+		                GL_RGBA, GL_UNSIGNED_BYTE, image_get_data(source));
+	}
+	image_free(rgba);
+
+
+	array.layers = count;
+	return array;
+}
+
+void renderer_delete_texture_array(TextureArray& array) {
+	TextureArray& active = g_RendererState.record_frame->texture_array;
+	if(active.id == array.id)
+		active = { 0, 0, 0, 0 };
+
+	if(array.id)
+		gl_delete_texture(array.id);
+	array = { 0, 0, 0, 0 };
+}
+
+void renderer_use_texture_array(const TextureArray& array) {
+	g_RendererState.record_frame->texture_array = array;
+}
+
+//======================================================================//
+//                            FRAME CAPTURE                             //
+//======================================================================//
+
+enum {
+	CAPTURE_MAGIC = 0x50414352, // "RCAP"
+	CAPTURE_VERSION = 1,
+};
+
+struct CaptureHeader {
+	uint32_t magic, version;
+	int32_t window_width, window_height;
+
+	vec3 camera_position;
+	quat camera_rotation;
+	mat4 camera_proj, camera_view;
+	float camera_properties[6];
+	uint32_t camera_orthographic;
+
+	uint32_t line_count, sprite_count, run_count, texture_count;
+	// index + 1 into the captured textures, 0 for an empty slot
+	uint32_t texture_slots[RNL_IMAGE_BIND_LIMIT];
+};
+
+struct CaptureTexture {
+	int32_t width, height;
+	uint32_t spec;
+};
+
+struct RenderCapture {
+	CaptureHeader header;
+	std::vector<DrawCommand> lines;
+	SpriteStream sprites;
+	std::vector<Texture2D> textures;
+};
+
+// RGBA8 contents and sampling spec of a slot texture, from the GPU or the
+// software renderer's copy.
+static void read_texture(unsigned int id, CaptureTexture& texture, std::vector<unsigned char>& pixels)
+{
+	if(const SoftwareTexture* source = software_texture(id)) {
+		texture.width = source->width;
+		texture.height = source->height;
+		texture.spec = (source->linear ? TEXTURESPEC_LINEAR : 0) | (source->clip ? TEXTURESPEC_CLIP : 0);
+
+		pixels.resize(source->texels.size() * 4);
+		for(size_t i=0; i<source->texels.size(); i++) {
+			for(int channel=0; channel<4; channel++)
+				pixels[i * 4 + channel] = (unsigned char)(source->texels[i] >> (channel * 8));
+		}
+		return;
+	}
+
+	gl_bind_texture(0, GL_TEXTURE_2D, id);
+
+	GLint filter, wrap;
+	glGetTexLevelParameteriv(GL_TEXTURE_2D, 0, GL_TEXTURE_WIDTH, &texture.width);
+	glGetTexLevelParameteriv(GL_TEXTURE_2D, 0, GL_TEXTURE_HEIGHT, &texture.height);
+	glGetTexParameteriv(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, &filter);
+	glGetTexParameteriv(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, &wrap);
+	texture.spec = (filter == GL_LINEAR ? TEXTURESPEC_LINEAR : 0) | 
+	               (wrap == GL_CLAMP_TO_EDGE ? TEXTURESPEC_CLIP : 0);
+
+	pixels.resize(size_t(texture.width) * texture.height * 4);
+	glPixelStorei(GL_PACK_ALIGNMENT, 1);
+	glGetTexImage(GL_TEXTURE_2D, 0, GL_RGBA, GL_UNSIGNED_BYTE, pixels.data());
+	glPixelStorei(GL_PACK_ALIGNMENT, 4);
+}
+
+static void write_capture(const char* path, const FrameSlot& frame)
+{
+	const RenderList& commands = frame.commands;
+	const Camera& camera = frame.camera;
+
+	std::ofstream file(path, std::ios::binary | std::ios::trunc);
+	if(!file) {
+		std::cout << "Can't write capture " << path << "\n";
+		return;
+	}
+
+	CaptureHeader header = {};
+	header.magic = CAPTURE_MAGIC;
+	header.version = CAPTURE_VERSION;
+	header.window_width = g_RendererState.window_width;
+	header.window_height = g_RendererState.window_height;
+	header.camera_position = camera.transform.getGlobalPosition();
+	header.camera_rotation = camera.transform.getGlobalRotation();
+	header.camera_proj = camera.proj;
+	header.camera_view = camera.view;
+	std::memcpy(header.camera_properties, &camera.orthographicProperties, sizeof(header.camera_properties));
+	header.camera_orthographic = camera.orthographic;
+	header.line_count = uint32_t(commands.line_commands.get_size());
+	header.sprite_count = uint32_t(commands.sprites.instances.size());
+	header.run_count = uint32_t(commands.sprites.runs.size());
+
+	std::vector<unsigned int> textures;
+	for(int slot=0; slot<g_RendererState.bind_slot_max; slot++) {
+		unsigned int id = resolve_texture(slot_texture(frame, slot));
+		if(!id) continue;
+
+		auto it = std::find(textures.begin(), textures.end(), id);
+		if(it == textures.end())
+			it = textures.insert(textures.end(), id);
+		header.texture_slots[slot] = uint32_t(it - textures.begin()) + 1;
+	}
+	header.texture_count = uint32_t(textures.size());
+
+	file.write((const char*) &header, sizeof(header));
+	for(size_t i=0; i<commands.line_commands.get_size(); i++)
+		file.write((const char*) &commands.line_commands.get(i), sizeof(DrawCommand));
+	file.write((const char*) commands.sprites.instances.data(), header.sprite_count * sizeof(Sprite));
+	file.write((const char*) commands.sprites.runs.data(), header.run_count * sizeof(SpriteRun));
+
+	std::vector<unsigned char> pixels;
+	for(unsigned int id : textures) {
+		CaptureTexture texture;
+		read_texture(id, texture, pixels);
+
+		file.write((const char*) &texture, sizeof(texture));
+		file.write((const char*) pixels.data(), pixels.size());
+	}
+
+	std::cout << "Captured frame to " << path << " (" << header.line_count << " lines, " 
+	          << header.sprite_count << " sprites, " << header.texture_count << " textures)\n";
+}
+
+static void write_pending_capture()
+{
+	std::string path;
+	{
+		std::lock_guard<std::mutex> lock(g_RendererState.capture_mutex);
+		if(g_RendererState.capture_path.empty()) return;
+		path.swap(g_RendererState.capture_path);
+	}
+
+	FrameSlot& frame = *g_RendererState.draw_frame;
+	if(!g_RendererState.pipelined)
+		merge_submitted_lists(frame.commands);
+
+	write_capture(path.c_str(), frame);
+}
+
+void renderer_capture_frame(const char* path)
+{
+	std::lock_guard<std::mutex> lock(g_RendererState.capture_mutex);
+	g_RendererState.capture_path = path ? path : "";
+}
+
+// Counts in the header must fit the file before anything is allocated for them.
+static bool capture_header_valid(const CaptureHeader& header, uint64_t file_size)
+{
+	if(header.magic != CAPTURE_MAGIC || header.version != CAPTURE_VERSION)
+		return false;
+
+	const uint64_t body = uint64_t(header.line_count) * sizeof(DrawCommand) +
+	                      uint64_t(header.sprite_count) * sizeof(Sprite) +
+	                      uint64_t(header.run_count) * sizeof(SpriteRun) +
+	                      uint64_t(header.texture_count) * sizeof(CaptureTexture);
+	if(body > file_size - sizeof(CaptureHeader))
+		return false;
+
+	for(uint32_t slot : header.texture_slots) {
+		if(slot > header.texture_count) return false;
+	}
+	return true;
+}
+
+// Runs must start inside the sprite array and never go backwards, replay
+// slices the instances between consecutive run starts.
+static bool capture_runs_valid(const SpriteStream& sprites)
+{
+	uint32_t previous = 0;
+	for(const SpriteRun& run : sprites.runs) {
+		if(run.first < previous || run.first > sprites.instances.size()) return false;
+		previous = run.first;
+	}
+	return true;
+}
+
+RenderCapture* renderer_load_capture(const char* path)
+{
+	std::ifstream file(path, std::ios::binary | std::ios::ate);
+	if(!file) {
+		std::cout << "Can't open capture " << path << "\n";
+		return nullptr;
+	}
+
+	const uint64_t file_size = uint64_t(file.tellg());
+	file.seekg(0);
+
+	RenderCapture* capture = new RenderCapture;
+	CaptureHeader& header = capture->header;
+	file.read((char*) &header, sizeof(header));
+	if(!file || !capture_header_valid(header, file_size)) {
+		std::cout << "Not a compatible capture: " << path << "\n";
+		delete capture;
+		return nullptr;
+	}
+
+	capture->lines.resize(header.line_count);
+	capture->sprites.instances.resize(header.sprite_count);
+	capture->sprites.runs.resize(header.run_count);
+	file.read((char*) capture->lines.data(), header.line_count * sizeof(DrawCommand));
+	file.read((char*) capture->sprites.instances.data(), header.sprite_count * sizeof(Sprite));
+	file.read((char*) capture->sprites.runs.data(), header.run_count * sizeof(SpriteRun));
+
+	if(file && !capture_runs_valid(capture->sprites)) {
+		std::cout << "Not a compatible capture: " << path << "\n";
+		delete capture;
+		return nullptr;
+	}
+
+	for(uint32_t i=0; i<header.texture_count && file; i++) {
+		CaptureTexture texture;
+		file.read((char*) &texture, sizeof(texture));
+		if(!file) break;
+
+		const uint64_t remaining = file_size - uint64_t(file.tellg());
+		if(texture.width <= 0 || texture.height <= 0 ||
+		   uint64_t(texture.width) * uint64_t(texture.height) * 4 > remaining) {
+			file.setstate(std::ios::failbit);
+			break;
+		}
+
+		size_t size = size_t(texture.width) * texture.height * 4;
+		std::vector<unsigned char> pixels(size);
+		file.read((char*) pixels.data(), size);
+
+		Image2D* image = image_initialize(texture.width, texture.height, 4);
+		for(size_t byte=0; byte<size; byte++)
+			image_write_pixel(image, byte, pixels[byte]);
+
+		capture->textures.push_back(renderer_load_texture(image, TextureSpec(texture.spec)));
+		image_free(image);
+	}
+
+	// every slot must name a loaded texture, replay indexes them directly
+	if(!file || capture->textures.size() != header.texture_count) {
+		std::cout << "Truncated capture: " << path << "\n";
+		renderer_destroy_capture(capture);
+		return nullptr;
+	}
+
+	return capture;
+}
+
+void renderer_destroy_capture(RenderCapture* capture)
+{
+	if(!capture) return;
+
+	for(Texture2D& texture : capture->textures)
+		renderer_delete_texture(texture);
+	delete capture;
+}
+
+void renderer_get_capture_resolution(const RenderCapture* capture, int& width, int& height)
+{
+	width = capture ? capture->header.window_width : 0;
+	height = capture ? capture->header.window_height : 0;
+}
+
+Camera renderer_replay_capture(const RenderCapture* capture)
+{
+	Camera camera = {};
+	if(!capture) return camera;
+
+	const CaptureHeader& header = capture->header;
+	RenderList& commands = g_RendererState.record_frame->commands;
+
+	for(const DrawCommand& line : capture->lines)
+		commands.line_commands.push_command(line);
+	stream_copy(commands.sprites, capture->sprites);
+
+	for(int slot=0; slot<RNL_IMAGE_BIND_LIMIT; slot++) {
+		uint32_t texture = header.texture_slots[slot];
+		if(texture)
+			renderer_bind_texture_slot(capture->textures[texture - 1], slot);
+	}
+
+	camera.transform.position = header.camera_position;
+	camera.transform.rotation = header.camera_rotation;
+	camera.proj = header.camera_proj;
+	camera.view = header.camera_view;
+	camera.orthographic = header.camera_orthographic != 0;
+	std::memcpy(&camera.orthographicProperties, header.camera_properties, sizeof(header.camera_properties));
+	return camera;
+}
+
+//======================================================================//
+//                            RENDER TARGET                             //
+//======================================================================//
+
+void renderer_set_render_resolution(int width, int height, RenderScale scale)
+{
+	RenderTargetSpec spec = { std::max(width, 0), std::max(height, 0), scale };
+
+	if(g_RendererState.pipelined) {
+		g_RendererState.record_frame->target_spec = spec;
+		g_RendererState.record_frame->target_changed = true;
+		return;
+	}
+
+	g_RendererState.target_spec = spec;
+}
+
 void renderer_begin() 
 {
-	//TODO: implement a render target
+	profiler_new_frame();
+	write_pending_capture();
+	file_watch_poll();
+
+	if(g_RendererState.uploader) {
+		ProfileScope scope(PROFILE_PASS_UPLOAD);
+		g_RendererState.uploader->update();
+	}
+
+	RenderTarget& target = g_RendererState.target;
+	int width = g_RendererState.target_spec.width;
+	int height = g_RendererState.target_spec.height;
+
+	// headless contexts may have no default framebuffer at all, and the
+	// software renderer always draws into its own frame
+	if((width == 0 || height == 0) && (g_RendererState.headless || g_RendererState.software)) {
+		width = g_RendererState.window_width;
+		height = g_RendererState.window_height;
+	}
+
+	if(SoftwareRasterizer* software = g_RendererState.software) {
+		if(software->getWidth() != width || software->getHeight() != height)
+			software->resize(width, height);
+		return;
+	}
+
+	if(width <= 0 || height <= 0) {
+		destroy_render_target(target);
+		return;
+	}
+
+	if(!target.fbo || target.width != width || target.height != height) {
+		destroy_render_target(target);
+		create_render_target(target, width, height);
+	}
+
+	gl_bind_framebuffer(GL_FRAMEBUFFER, target.fbo);
+	glViewport(0, 0, target.width, target.height);
 }
 
 void renderer_end()
 {
-	//TODO: implement a render target
+	if(g_RendererState.software || !g_RendererState.target.fbo) return;
+
+	gl_bind_framebuffer(GL_FRAMEBUFFER, 0);
+	glViewport(0, 0, g_RendererState.window_width, g_RendererState.window_height);
 }
 
 void renderer_blit(const Window* window) 
 {
-	//TODO: implement a render target
+	if(g_RendererState.headless || (!g_RendererState.target.fbo && !g_RendererState.software)) return;
+
+	ProfileScope scope(PROFILE_PASS_BLIT);
+	if(g_RendererState.software)
+		upload_software_frame();
+
+	const RenderTarget& target = g_RendererState.target;
+	const int window_width = g_RendererState.window_width;
+	const int window_height = g_RendererState.window_height;
+	if(!target.fbo || window_width <= 0 || window_height <= 0) return;
+
+	int width = window_width, height = window_height;
+	switch(g_RendererState.target_spec.scale) {
+		case RENDERSCALE_INTEGER: {
+			int scale = std::max(1, std::min(window_width / target.width, window_height / target.height));
+			width = target.width * scale;
+			height = target.height * scale;
+		} break;
+		case RENDERSCALE_FIT: {
+			float scale = std::min(float(window_width) / target.width, float(window_height) / target.height);
+			width = int(target.width * scale);
+			height = int(target.height * scale);
+		} break;
+		case RENDERSCALE_STRETCH:
+			break;
+	}
+
+	const int x = (window_width - width) / 2;
+	const int y = (window_height - height) / 2;
+
+	gl_bind_framebuffer(GL_DRAW_FRAMEBUFFER, 0);
+	if(width < window_width || height < window_height) {
+		glClearColor(0, 0, 0, 1);
+		glClear(GL_COLOR_BUFFER_BIT);
+	}
+
+	gl_bind_framebuffer(GL_READ_FRAMEBUFFER, target.fbo);
+	glBlitFramebuffer(0, 0, target.width, target.height,
+	                  x, y, x + width, y + height, GL_COLOR_BUFFER_BIT, GL_NEAREST);
+	gl_bind_framebuffer(GL_READ_FRAMEBUFFER, 0);
+}
+
+bool renderer_read_pixels(int x, int y, int width, int height, unsigned char* rgba)
+{
+	const RenderTarget& target = g_RendererState.target;
+	const SoftwareRasterizer* software = g_RendererState.software;
+	int source_width = target.fbo ? target.width : g_RendererState.window_width;
+	int source_height = target.fbo ? target.height : g_RendererState.window_height;
+	if(software) {
+		source_width = software->getWidth();
+		source_height = software->getHeight();
+	}
+
+	if(!rgba || x < 0 || y < 0 || width <= 0 || height <= 0 || 
+	   x + width > source_width || y + height > source_height)
+		return false;
+
+	if(software) {
+		for(int row=0; row<height; row++) {
+			const uint32_t* source = software->getPixels() + size_t(y + row) * source_width + x;
+			unsigned char* dest = rgba + size_t(row) * width * 4;
+			for(int i=0; i<width; i++) {
+				for(int channel=0; channel<4; channel++)
+					dest[i * 4 + channel] = (unsigned char)(source[i] >> (channel * 8));
+			}
+		}
+		return true;
+	}
+
+	gl_bind_framebuffer(GL_READ_FRAMEBUFFER, target.fbo);
+	glPixelStorei(GL_PACK_ALIGNMENT, 1);
+	glReadPixels(x, y, width, height, GL_RGBA, GL_UNSIGNED_BYTE, rgba);
+	glPixelStorei(GL_PACK_ALIGNMENT, 4);
+	gl_bind_framebuffer(GL_READ_FRAMEBUFFER, 0);
+	return true;
+}
+
+//======================================================================//
+//                       PIPELINED RENDER THREAD                        //
+//======================================================================//
+
+static void render_thread_main()
+{
+	window_make_context_current(g_RendererState.window);
+	gl_state_invalidate();
+
+	int index;
+	for(;;) {
+		g_RendererState.ready_count.acquire();
+		g_RendererState.ready_frames.pop_front(index);
+		if(index < 0) break;
+
+		FrameSlot& frame = g_RendererState.frames[index];
+		g_RendererState.draw_frame = &frame;
+
+		if(frame.viewport_width > 0) {
+			g_RendererState.window_width = frame.viewport_width;
+			g_RendererState.window_height = frame.viewport_height;
+			if(!g_RendererState.software)
+				glViewport(0, 0, frame.viewport_width, frame.viewport_height);
+		}
+		if(frame.target_changed)
+			g_RendererState.target_spec = frame.target_spec;
+
+		g_RendererState.render_frame(frame.camera);
+
+		frame.commands.line_commands.clear();
+		stream_clear(frame.commands.sprites);
+
+		g_RendererState.free_frames.push_command(index);
+		g_RendererState.free_count.release();
+	}
+
+	window_release_context();
+}
+
+void renderer_pipeline_start(const Window* window, int frame_latency, RenderFrameFn render_frame)
+{
+	if(g_RendererState.pipelined) {
+		std::cout << "Render pipeline already running\n";
+		return;
+	}
+
+	g_RendererState.window = window;
+	g_RendererState.render_frame = render_frame;
+	if(frame_latency <= 0 || !render_frame)
+		return;
+
+	frame_latency = MIN(frame_latency, RNL_MAX_FRAME_LATENCY);
+
+	// the recording slot stays with the simulation, the rest start out free
+	FrameSlot* record = g_RendererState.record_frame;
+	for(int i=0, queued=0; i<=RNL_MAX_FRAME_LATENCY && queued<frame_latency; i++) {
+		if(&g_RendererState.frames[i] == record) continue;
+		g_RendererState.free_frames.push_command(i);
+		g_RendererState.free_count.release();
+		queued++;
+	}
+
+	window_release_context();
+	g_RendererState.pipelined = true;
+	g_RendererState.render_thread = std::thread(render_thread_main);
+}
+
+void renderer_pipeline_stop()
+{
+	if(!g_RendererState.pipelined) {
+		g_RendererState.render_frame = nullptr;
+		return;
+	}
+
+	// frames already queued are still drawn before the thread sees the stop
+	g_RendererState.ready_frames.push_command(-1);
+	g_RendererState.ready_count.release();
+	g_RendererState.render_thread.join();
+
+	int index;
+	while(g_RendererState.free_count.try_acquire()) {
+		g_RendererState.free_frames.pop_front(index);
+	}
+
+	g_RendererState.pipelined = false;
+	g_RendererState.render_frame = nullptr;
+	g_RendererState.draw_frame = g_RendererState.record_frame;
+	window_make_context_current(g_RendererState.window);
+}
+
+void renderer_submit_frame(const Camera& camera)
+{
+	if(!g_RendererState.render_frame) return;
+
+	if(!g_RendererState.pipelined) {
+		g_RendererState.draw_frame->camera = camera;
+		g_RendererState.render_frame(camera);
+		return;
+	}
+
+	FrameSlot* frame = g_RendererState.record_frame;
+	merge_submitted_lists(frame->commands);
+	frame->camera = camera;
+
+	g_RendererState.ready_frames.push_command(int(frame - g_RendererState.frames));
+	g_RendererState.ready_count.release();
+
+	int index;
+	g_RendererState.free_count.acquire();
+	g_RendererState.free_frames.pop_front(index);
+
+	FrameSlot* next = &g_RendererState.frames[index];
+	next->viewport_width = next->viewport_height = 0;
+	next->target_changed = false;
+	next->commands.sprites.layer = frame->commands.sprites.layer;
+	next->commands.sprites.depth = frame->commands.sprites.depth;
+	std::copy(std::begin(frame->texture_slots), std::end(frame->texture_slots), next->texture_slots);
+	next->texture_array = frame->texture_array;
+	g_RendererState.record_frame = next;
 }
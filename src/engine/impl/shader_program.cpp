@@ -1,9 +1,69 @@
 #include "../shader_program.hpp"
+#include "../gl_state.hpp"
+#include "../file_watch.hpp"
 #include <glad/glad.h>
 #include <iostream>
 #include <fstream>
 #include <string>
 #include <sstream>
+#include <unordered_map>
+#include <string_view>
+#include <cstdint>
+#include <filesystem>
+#include <cstdio>
+#include <vector>
+
+// FNV-1a; transparent, so lookups hash the caller's string without a copy
+struct UniformNameHash {
+	using is_transparent = void;
+
+	size_t operator()(std::string_view name) const {
+		uint32_t hash = 2166136261u;
+		for (char c : name) {
+			hash ^= (unsigned char) c;
+			hash *= 16777619u;
+		}
+		return hash;
+	}
+};
+
+// Active uniforms of a linked program by name. Array uniforms are reachable
+// both as "name[0]" and "name".
+struct ShaderReflection {
+	std::unordered_map<std::string, int, UniformNameHash, std::equal_to<>> locations;
+};
+
+// Keyed by program ID so Shader stays a plain copyable handle. Built at link,
+// rebuilt on relink and dropped by shader_delete_program().
+static std::unordered_map<unsigned int, ShaderReflection> s_Reflections;
+
+static void reflect_uniforms(unsigned int program)
+{
+	ShaderReflection& reflection = s_Reflections[program];
+	reflection.locations.clear();
+
+	int count = 0, max_length = 0;
+	glGetProgramiv(program, GL_ACTIVE_UNIFORMS, &count);
+	glGetProgramiv(program, GL_ACTIVE_UNIFORM_MAX_LENGTH, &max_length);
+
+	std::string name(max_length + 1, '\0');
+	for (int i = 0; i < count; i++) {
+		GLsizei length = 0;
+		GLint size;
+		GLenum type;
+		glGetActiveUniform(program, i, name.size(), &length, &size, &type, name.data());
+
+		int location = glGetUniformLocation(program, name.c_str());
+		if (location < 0) continue; // uniform block members
+
+		std::string_view uniform(name.c_str(), length);
+		reflection.locations.emplace(uniform, location);
+
+		size_t bracket = uniform.find('[');
+		if (bracket != std::string_view::npos)
+			reflection.locations.emplace(uniform.substr(0, bracket), location);
+	}
+}
 
 void checkCompileErrors(unsigned int shader, std::string type)
 {
@@ -31,9 +91,155 @@ void checkCompileErrors(unsigned int shader, std::string type)
 	}
 }
 
+//======================================================================//
+//                         PROGRAM BINARY CACHE                         //
+//======================================================================//
+
+// Cache files are a header followed by the glGetProgramBinary blob. The
+// file name is derived from the sources and the driver, the header repeats
+// both so a collision or a driver update just means a recompile.
+struct ProgramBinaryHeader {
+	uint32_t magic;
+	uint32_t format;
+	uint64_t source_hash;
+	uint64_t driver_hash;
+	uint32_t length;
+	uint32_t padding;
+};
+
+static constexpr uint32_t PROGRAM_BINARY_MAGIC = 0x31425352; // "RSB1"
+
+static std::string s_BinaryCacheDirectory;
+
+static uint64_t hash_bytes(const char* data, uint64_t hash = 14695981039346656037ull)
+{
+	for (; *data; data++) {
+		hash ^= (unsigned char) *data;
+		hash *= 1099511628211ull;
+	}
+	return hash;
+}
+
+static uint64_t hash_sources(const char* vertex_source, const char* fragment_source)
+{
+	// hash the separator too, so moving text between stages changes the key
+	return hash_bytes(fragment_source, hash_bytes("\x1f", hash_bytes(vertex_source)));
+}
+
+static uint64_t hash_driver()
+{
+	uint64_t hash = 14695981039346656037ull;
+	GLenum strings[] = { GL_VENDOR, GL_RENDERER, GL_VERSION };
+	for (GLenum name : strings) {
+		const char* value = (const char*) glGetString(name);
+		hash = hash_bytes(value ? value : "", hash);
+	}
+	return hash;
+}
+
+static bool binary_cache_enabled()
+{
+	if (s_BinaryCacheDirectory.empty() || !GLAD_GL_VERSION_4_1) return false;
+
+	int formats = 0;
+	glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formats);
+	return formats > 0;
+}
+
+static std::filesystem::path binary_cache_path(uint64_t source_hash, uint64_t driver_hash)
+{
+	char name[40];
+	std::snprintf(name, sizeof(name), "%016llx%016llx.bin", 
+	              (unsigned long long) source_hash, (unsigned long long) driver_hash);
+	return std::filesystem::path(s_BinaryCacheDirectory) / name;
+}
+
+// Returns a linked program or 0 if there is no usable binary on disk.
+static unsigned int load_program_binary(uint64_t source_hash, uint64_t driver_hash)
+{
+	std::ifstream file(binary_cache_path(source_hash, driver_hash), std::ios::binary);
+	if (!file) return 0;
+
+	ProgramBinaryHeader header;
+	if (!file.read((char*) &header, sizeof(header))) return 0;
+	if (header.magic != PROGRAM_BINARY_MAGIC || 
+	    header.source_hash != source_hash || 
+	    header.driver_hash != driver_hash) 
+		return 0;
+
+	std::vector<char> binary(header.length);
+	if (!file.read(binary.data(), binary.size())) return 0;
+
+	unsigned int program = glCreateProgram();
+	glProgramBinary(program, header.format, binary.data(), binary.size());
+
+	int success = 0;
+	glGetProgramiv(program, GL_LINK_STATUS, &success);
+	if (!success) {
+		// the driver may reject binaries at any time, e.g. after an update
+		glDeleteProgram(program);
+		return 0;
+	}
+
+	return program;
+}
+
+static void store_program_binary(unsigned int program, uint64_t source_hash, uint64_t driver_hash)
+{
+	int length = 0;
+	glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length);
+	if (length <= 0) return;
+
+	std::vector<char> binary(length);
+	GLenum format = 0;
+	glGetProgramBinary(program, length, &length, &format, binary.data());
+
+	std::error_code error;
+	std::filesystem::create_directories(s_BinaryCacheDirectory, error);
+
+	std::ofstream file(binary_cache_path(source_hash, driver_hash), std::ios::binary | std::ios::trunc);
+	if (!file) {
+		std::cout << "Shader cache: can't write to " << s_BinaryCacheDirectory << "\n";
+		return;
+	}
+
+	ProgramBinaryHeader header = {
+		.magic = PROGRAM_BINARY_MAGIC,
+		.format = format,
+		.source_hash = source_hash,
+		.driver_hash = driver_hash,
+		.length = (uint32_t) length,
+		.padding = 0,
+	};
+	file.write((const char*) &header, sizeof(header));
+	file.write(binary.data(), length);
+}
+
+void shader_set_binary_cache(const char* directory)
+{
+	s_BinaryCacheDirectory = directory ? directory : "";
+}
+
+//======================================================================//
+//                              COMPILATION                             //
+//======================================================================//
+
 void shader_load_glsl_from_source(const char* vertex_source, 
                     const char* fragment_source, Shader& program)
 {
+	const bool use_cache = binary_cache_enabled();
+	uint64_t source_hash = 0, driver_hash = 0;
+
+	if (use_cache) {
+		source_hash = hash_sources(vertex_source, fragment_source);
+		driver_hash = hash_driver();
+		program.ID = load_program_binary(source_hash, driver_hash);
+		if (program.ID) {
+			reflect_uniforms(program.ID);
+			return;
+		}
+	}
+
 	unsigned int vertex, fragment;
 	// vertex shader
 	vertex = glCreateShader(GL_VERTEX_SHADER);
@@ -49,18 +255,24 @@ void shader_load_glsl_from_source(const char* vertex_source,
 	program.ID = glCreateProgram();
 	glAttachShader(program.ID, vertex);
 	glAttachShader(program.ID, fragment);
+	if (use_cache)
+		glProgramParameteri(program.ID, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
 	glLinkProgram(program.ID);
 	checkCompileErrors(program.ID, "PROGRAM");
+	reflect_uniforms(program.ID);
+
+	int linked = 0;
+	glGetProgramiv(program.ID, GL_LINK_STATUS, &linked);
+	if (use_cache && linked)
+		store_program_binary(program.ID, source_hash, driver_hash);
+
 	glDeleteShader(vertex);
 	glDeleteShader(fragment);
 }
 
-void shader_load_glsl(const char* vertexPath, 
-                      const char* fragmentPath, 
-                      Shader& program)
+static bool read_shader_files(const char* vertexPath, const char* fragmentPath,
+                              std::string& vertexCode, std::string& fragmentCode)
 {
-	std::string vertexCode;
-	std::string fragmentCode;
 	std::ifstream vShaderFile;
 	std::ifstream fShaderFile;
 
@@ -81,66 +293,232 @@ void shader_load_glsl(const char* vertexPath,
 	catch (std::ifstream::failure &e)
 	{
 		std::cout << "ERROR::SHADER::FILE_NOT_SUCCESSFULLY_READ: " << e.what() << std::endl;
+		return false;
 	}
 
+	return true;
+}
+
+//======================================================================//
+//                              HOT RELOAD                              //
+//======================================================================//
+
+// A program loaded from files, relinked in place when either file changes.
+struct WatchedProgram {
+	std::string vertex_path, fragment_path;
+	unsigned int id;
+	int watches[2];
+};
+
+static std::vector<WatchedProgram*> s_WatchedPrograms;
+
+static void reload_program(const char* path, void* user)
+{
+	WatchedProgram* watched = (WatchedProgram*) user;
+
+	std::string vertexCode, fragmentCode;
+	if (!read_shader_files(watched->vertex_path.c_str(), watched->fragment_path.c_str(), 
+	                       vertexCode, fragmentCode))
+		return;
+
+	const char* vertex_source = vertexCode.c_str();
+	const char* fragment_source = fragmentCode.c_str();
+
+	unsigned int vertex = glCreateShader(GL_VERTEX_SHADER);
+	glShaderSource(vertex, 1, &vertex_source, 0L);
+	glCompileShader(vertex);
+	checkCompileErrors(vertex, "VERTEX");
+	unsigned int fragment = glCreateShader(GL_FRAGMENT_SHADER);
+	glShaderSource(fragment, 1, &fragment_source, 0L);
+	glCompileShader(fragment);
+	checkCompileErrors(fragment, "FRAGMENT");
+
+	// link a scratch program first, so a broken edit leaves the running one intact
+	unsigned int scratch = glCreateProgram();
+	glAttachShader(scratch, vertex);
+	glAttachShader(scratch, fragment);
+	glLinkProgram(scratch);
+	checkCompileErrors(scratch, "PROGRAM");
+
+	int linked = 0;
+	glGetProgramiv(scratch, GL_LINK_STATUS, &linked);
+	gl_delete_program(scratch);
+
+	if (linked) {
+		unsigned int attached[8];
+		GLsizei count = 0;
+		glGetAttachedShaders(watched->id, 8, &count, attached);
+		for (GLsizei i = 0; i < count; i++)
+			glDetachShader(watched->id, attached[i]);
+
+		glAttachShader(watched->id, vertex);
+		glAttachShader(watched->id, fragment);
+		glLinkProgram(watched->id);
+
+		reflect_uniforms(watched->id);
+
+		std::cout << "Reloaded shader " << path << std::endl;
+	}
+
+	glDeleteShader(vertex);
+	glDeleteShader(fragment);
+}
+
+static void watch_program(const char* vertexPath, const char* fragmentPath, const Shader& program)
+{
+	if (!program.ID || !file_watch_is_enabled()) return;
+
+	WatchedProgram* watched = new WatchedProgram { vertexPath, fragmentPath, program.ID, {} };
+	watched->watches[0] = file_watch_add(vertexPath, reload_program, watched);
+	watched->watches[1] = file_watch_add(fragmentPath, reload_program, watched);
+	s_WatchedPrograms.push_back(watched);
+}
+
+static void unwatch_program(unsigned int id)
+{
+	for (size_t i = 0; i < s_WatchedPrograms.size(); i++) {
+		WatchedProgram* watched = s_WatchedPrograms[i];
+		if (watched->id != id) continue;
+
+		file_watch_remove(watched->watches[0]);
+		file_watch_remove(watched->watches[1]);
+		delete watched;
+		s_WatchedPrograms.erase(s_WatchedPrograms.begin() + i);
+		return;
+	}
+}
+
+void shader_load_glsl(const char* vertexPath, 
+                      const char* fragmentPath, 
+                      Shader& program)
+{
+	std::string vertexCode;
+	std::string fragmentCode;
+	read_shader_files(vertexPath, fragmentPath, vertexCode, fragmentCode);
+
 	const char *vShaderCode = vertexCode.c_str();
 	const char *fShaderCode = fragmentCode.c_str();
 	
 	shader_load_glsl_from_source(vShaderCode, fShaderCode, program);
+	watch_program(vertexPath, fragmentPath, program);
 }
 
 void shader_use_program(const Shader &program)
 {
-	glUseProgram(program.ID);
+	gl_use_program(program.ID);
 }
 
 void shader_delete_program(const Shader& program)
 {
-	glDeleteProgram(program.ID);
+	unwatch_program(program.ID);
+	gl_delete_program(program.ID);
+	s_Reflections.erase(program.ID);
+}
+
+UniformHandle shader_get_uniform(const Shader& program, const char* name)
+{
+	auto reflection = s_Reflections.find(program.ID);
+	if (reflection == s_Reflections.end())
+		return glGetUniformLocation(program.ID, name);
+
+	const auto& locations = reflection->second.locations;
+	auto it = locations.find(std::string_view(name));
+	return it == locations.end() ? -1 : it->second;
 }
 
 void shader_upload_int(const Shader& program, const char* name, int v)
 {
-	glUniform1i(glGetUniformLocation(program.ID, name), v);
+	glUniform1i(shader_get_uniform(program, name), v);
 }
 
 void shader_upload_int_array(const Shader& program, const char* name, int* v, size_t size)
 {
-	glUniform1iv(glGetUniformLocation(program.ID, name), size, v);
+	glUniform1iv(shader_get_uniform(program, name), size, v);
 }
 
 void shader_upload_float(const Shader& program, const char* name, float v)
 {
-	glUniform1f(glGetUniformLocation(program.ID, name), v);
+	glUniform1f(shader_get_uniform(program, name), v);
 }
 
 void shader_upload_vec2(const Shader& program, const char* name, float x, float y)
 {
-	glUniform2f(glGetUniformLocation(program.ID, name), x, y);
+	glUniform2f(shader_get_uniform(program, name), x, y);
 }
 
 
 void shader_upload_vec3(const Shader& program, 
     const char* name, float x, float y, float z)
 {
-	glUniform3f(glGetUniformLocation(program.ID, name), x, y, z);
+	glUniform3f(shader_get_uniform(program, name), x, y, z);
 }
 
 void shader_upload_vec4(const Shader& program, 
 	const char* name, float x, float y, float z, float w)
 {
-	glUniform4f(glGetUniformLocation(program.ID, name), x, y, z, w);
+	glUniform4f(shader_get_uniform(program, name), x, y, z, w);
 }
 
 void shader_upload_float_array(const Shader& program, const char* name, 
 	const float* array, size_t size)
 {
-	glUniform1fv(glGetUniformLocation(program.ID, name), size, array);
+	glUniform1fv(shader_get_uniform(program, name), size, array);
 }
 
 void shader_upload_mat4(const Shader& program, 
 	const char* name, const float* mat)
 {
-	GLint location = glGetUniformLocation(program.ID, name);
+	GLint location = shader_get_uniform(program, name);
 	glUniformMatrix4fv(location, 1, GL_FALSE, mat);
 }
+
+// glUniform* writes the bound program, so make sure that's the handle's own.
+// Filtered by gl_state, free when the caller already bound it.
+void shader_upload_int(const Shader& program, UniformHandle handle, int v)
+{
+	gl_use_program(program.ID);
+	glUniform1i(handle, v);
+}
+
+void shader_upload_int_array(const Shader& program, UniformHandle handle, int* v, size_t size)
+{
+	gl_use_program(program.ID);
+	glUniform1iv(handle, size, v);
+}
+
+void shader_upload_float(const Shader& program, UniformHandle handle, float v)
+{
+	gl_use_program(program.ID);
+	glUniform1f(handle, v);
+}
+
+void shader_upload_vec2(const Shader& program, UniformHandle handle, float x, float y)
+{
+	gl_use_program(program.ID);
+	glUniform2f(handle, x, y);
+}
+
+void shader_upload_vec3(const Shader& program, UniformHandle handle, float x, float y, float z)
+{
+	gl_use_program(program.ID);
+	glUniform3f(handle, x, y, z);
+}
+
+void shader_upload_vec4(const Shader& program, UniformHandle handle, float x, float y, float z, float w)
+{
+	gl_use_program(program.ID);
+	glUniform4f(handle, x, y, z, w);
+}
+
+void shader_upload_float_array(const Shader& program, UniformHandle handle, 
+	const float* array, size_t size)
+{
+	gl_use_program(program.ID);
+	glUniform1fv(handle, size, array);
+}
+
+void shader_upload_mat4(const Shader& program, UniformHandle handle, const float* mat)
+{
+	gl_use_program(program.ID);
+	glUniformMatrix4fv(handle, 1, GL_FALSE, mat);
+}
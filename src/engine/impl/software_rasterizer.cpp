@@ -0,0 +1,483 @@
+#include "../software_rasterizer.hpp"
+#include <algorithm>
+#include <cmath>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define SOFTWARE_RASTER_SSE2
+#endif
+
+SoftwareRasterizer::SoftwareRasterizer(unsigned int thread_count)
+{
+	if(thread_count == 0)
+		thread_count = std::max(1u, std::thread::hardware_concurrency());
+
+	// the thread calling flush() works on tiles too
+	for(unsigned int i=1; i<thread_count; i++)
+		workers.emplace_back(&SoftwareRasterizer::_worker_main, this);
+}
+
+SoftwareRasterizer::~SoftwareRasterizer()
+{
+	{
+		std::lock_guard<std::mutex> lock(job_mutex);
+		stopping = true;
+	}
+	job_start.notify_all();
+
+	for(std::thread& worker : workers)
+		worker.join();
+}
+
+void SoftwareRasterizer::resize(int new_width, int new_height)
+{
+	flush();
+
+	width = std::max(new_width, 0);
+	height = std::max(new_height, 0);
+	pixels.assign(size_t(width) * height, 0);
+
+	tiles_x = (width + TILE_SIZE - 1) / TILE_SIZE;
+	tiles_y = (height + TILE_SIZE - 1) / TILE_SIZE;
+	bins.assign(size_t(tiles_x) * tiles_y, {});
+}
+
+static uint32_t pack_rgba8(float r, float g, float b, float a)
+{
+	auto channel = [](float v) { return uint32_t(std::lrintf(clamp(0.0f, 1.0f, v) * 255.0f)); };
+	return channel(r) | (channel(g) << 8) | (channel(b) << 16) | (channel(a) << 24);
+}
+
+static void unpack_rgba8(uint32_t c, float out[4])
+{
+	for(int i=0; i<4; i++)
+		out[i] = float((c >> (i * 8)) & 0xFF) * (1.0f / 255.0f);
+}
+
+void SoftwareRasterizer::clear(const vec4& color)
+{
+	flush();
+	std::fill(pixels.begin(), pixels.end(), pack_rgba8(color.x, color.y, color.z, color.w));
+}
+
+void SoftwareRasterizer::setCamera(const mat4& proj, const mat4& view)
+{
+	view_proj = proj * view;
+}
+
+void SoftwareRasterizer::setTexture(int slot, const SoftwareTexture* texture)
+{
+	if(slot >= 0 && slot < TEXTURE_SLOTS)
+		textures[slot] = texture;
+}
+
+//======================================================================//
+//                             PRIMITIVES                               //
+//======================================================================//
+
+// p0, p1 and p3 are the world positions of the unit quad's (0,0), (1,0) and
+// (0,1) corners, the same expansion the vertex shaders do.
+void SoftwareRasterizer::_add_quad(vec2 p0, vec2 p1, vec2 p3, Primitive primitive)
+{
+	auto to_screen = [&](vec2 p) {
+		vec3 ndc = view_proj * vec3(p.x, p.y, 0.0f);
+		return vec2((ndc.x * 0.5f + 0.5f) * width, (ndc.y * 0.5f + 0.5f) * height);
+	};
+
+	vec2 origin = to_screen(p0);
+	vec2 axis_s = to_screen(p1) - origin;
+	vec2 axis_t = to_screen(p3) - origin;
+
+	float det = axis_s.x * axis_t.y - axis_s.y * axis_t.x;
+	if(std::fabs(det) < 1e-8f) return;
+
+	primitive.origin = origin;
+	primitive.inverse[0] =  axis_t.y / det;
+	primitive.inverse[1] = -axis_t.x / det;
+	primitive.inverse[2] = -axis_s.y / det;
+	primitive.inverse[3] =  axis_s.x / det;
+
+	vec2 corners[3] = { origin + axis_s, origin + axis_t, origin + axis_s + axis_t };
+	vec2 lo = origin, hi = origin;
+	for(const vec2& c : corners) {
+		lo = MIN(lo, c);
+		hi = MAX(hi, c);
+	}
+
+	primitive.min_x = std::max(0, int(std::floor(lo.x)));
+	primitive.min_y = std::max(0, int(std::floor(lo.y)));
+	primitive.max_x = std::min(width, int(std::ceil(hi.x)));
+	primitive.max_y = std::min(height, int(std::ceil(hi.y)));
+	if(primitive.min_x >= primitive.max_x || primitive.min_y >= primitive.max_y) return;
+
+	uint32_t index = uint32_t(primitives.size());
+	primitives.push_back(primitive);
+
+	for(int ty = primitive.min_y / TILE_SIZE; ty <= (primitive.max_y - 1) / TILE_SIZE; ty++) {
+		for(int tx = primitive.min_x / TILE_SIZE; tx <= (primitive.max_x - 1) / TILE_SIZE; tx++)
+			bins[ty * tiles_x + tx].push_back(index);
+	}
+}
+
+void SoftwareRasterizer::addSprite(const Sprite& sprite)
+{
+	Primitive primitive = {};
+	primitive.color = sprite.color;
+	primitive.uv_min = sprite.uvmin;
+	primitive.uv_max = sprite.uvmax;
+	primitive.size = sprite.size;
+
+	int slot = int(sprite.texid);
+	primitive.texture = (slot >= 0 && slot < TEXTURE_SLOTS) ? textures[slot] : nullptr;
+	primitive.kind = PRIMITIVE_SPRITE;
+	if(!primitive.texture) {
+		// an unbound GL sampler reads opaque black
+		primitive.kind = PRIMITIVE_SOLID;
+		primitive.color = vec4(0.0f, 0.0f, 0.0f, sprite.color.w);
+	}
+
+	vec2 p0 = sprite.position;
+	_add_quad(p0, p0 + vec2(sprite.size.x, 0.0f), p0 + vec2(0.0f, sprite.size.y), primitive);
+}
+
+void SoftwareRasterizer::addLine(vec2 p1, vec2 p2, const vec4& color, float line_width)
+{
+	Primitive primitive = {};
+	primitive.color = color;
+	primitive.kind = PRIMITIVE_SOLID;
+
+	vec2 d = p2 - p1;
+	float len = std::sqrt(d.x * d.x + d.y * d.y);
+	vec2 dir = len > 0.0f ? d * (1.0f / len) : vec2(1.0f, 0.0f);
+	vec2 normal(-dir.y, dir.x);
+	float half_width = line_width * 0.5f;
+
+	vec2 start = p1 - dir * half_width - normal * half_width;
+	_add_quad(start, p2 + dir * half_width - normal * half_width, start + normal * line_width, primitive);
+}
+
+void SoftwareRasterizer::addBox(vec2 min, vec2 max, const vec4& color, float line_width)
+{
+	Primitive primitive = {};
+	primitive.color = color;
+	primitive.kind = PRIMITIVE_BOX;
+
+	vec2 center = (min + max) * 0.5f;
+	vec2 half_extent = vec2(std::fabs(max.x - min.x), std::fabs(max.y - min.y)) * 0.5f
+	                 + vec2(line_width * 0.5f);
+	primitive.half_extent = half_extent;
+	primitive.inner_extent = half_extent - vec2(line_width);
+
+	vec2 p0 = center - half_extent;
+	_add_quad(p0, p0 + vec2(half_extent.x * 2.0f, 0.0f), p0 + vec2(0.0f, half_extent.y * 2.0f), primitive);
+}
+
+//======================================================================//
+//                               SHADING                                //
+//======================================================================//
+
+static uint32_t fetch_texel(const SoftwareTexture& texture, int x, int y)
+{
+	if(texture.clip) {
+		x = std::clamp(x, 0, texture.width - 1);
+		y = std::clamp(y, 0, texture.height - 1);
+	}
+	else {
+		x %= texture.width;
+		y %= texture.height;
+		if(x < 0) x += texture.width;
+		if(y < 0) y += texture.height;
+	}
+	return texture.texels[size_t(y) * texture.width + x];
+}
+
+// Mirrors the sprite fragment shader: the UV is pulled to the texel centre
+// except within one screen pixel of a texel edge, so linear filtering only
+// blends across edges and nearest sampling stays on the covering texel.
+static void sample_sprite(const SoftwareTexture& texture, vec2 size, float u, float v, float out[4])
+{
+	const float w = float(texture.width), h = float(texture.height);
+	const float tx = u * w, ty = v * h;
+	const float fx = std::floor(tx), fy = std::floor(ty);
+
+	if(!texture.linear) {
+		unpack_rgba8(fetch_texel(texture, int(fx), int(fy)), out);
+		return;
+	}
+
+	const float px_per_tex_x = size.x / w, px_per_tex_y = size.y / h;
+	const float rx = tx - fx, ry = ty - fy;
+	float sx = fx + 0.5f + clamp(0.0f, 0.5f, rx * px_per_tex_x) - clamp(0.0f, 0.5f, (1.0f - rx) * px_per_tex_x);
+	float sy = fy + 0.5f + clamp(0.0f, 0.5f, ry * px_per_tex_y) - clamp(0.0f, 0.5f, (1.0f - ry) * px_per_tex_y);
+
+	sx -= 0.5f;
+	sy -= 0.5f;
+	const int x0 = int(std::floor(sx)), y0 = int(std::floor(sy));
+	const float ax = sx - x0, ay = sy - y0;
+
+	float c00[4], c10[4], c01[4], c11[4];
+	unpack_rgba8(fetch_texel(texture, x0,     y0),     c00);
+	unpack_rgba8(fetch_texel(texture, x0 + 1, y0),     c10);
+	unpack_rgba8(fetch_texel(texture, x0,     y0 + 1), c01);
+	unpack_rgba8(fetch_texel(texture, x0 + 1, y0 + 1), c11);
+
+	for(int i=0; i<4; i++) {
+		float top = c00[i] + (c10[i] - c00[i]) * ax;
+		float bottom = c01[i] + (c11[i] - c01[i]) * ax;
+		out[i] = top + (bottom - top) * ay;
+	}
+}
+
+bool SoftwareRasterizer::_covers(const Primitive& p, float s, float t)
+{
+	if(s < 0.0f || s >= 1.0f || t < 0.0f || t >= 1.0f) return false;
+	if(p.kind != PRIMITIVE_BOX) return true;
+
+	float lx = std::fabs(s * 2.0f - 1.0f) * p.half_extent.x;
+	float ly = std::fabs(t * 2.0f - 1.0f) * p.half_extent.y;
+	return !(lx < p.inner_extent.x && ly < p.inner_extent.y);
+}
+
+void SoftwareRasterizer::_shade(const Primitive& p, float s, float t, float out[4])
+{
+	out[0] = p.color.x; out[1] = p.color.y; out[2] = p.color.z; out[3] = p.color.w;
+	if(p.kind != PRIMITIVE_SPRITE) return;
+
+	float texel[4];
+	sample_sprite(*p.texture, p.size,
+	              p.uv_min.x + s * (p.uv_max.x - p.uv_min.x),
+	              p.uv_min.y + t * (p.uv_max.y - p.uv_min.y), texel);
+	for(int i=0; i<4; i++)
+		out[i] *= texel[i];
+}
+
+#if defined(SOFTWARE_RASTER_SSE2)
+// floor() for SSE2, which only has truncating conversions
+static __m128 floor4(__m128 v)
+{
+	__m128 truncated = _mm_cvtepi32_ps(_mm_cvttps_epi32(v));
+	return _mm_sub_ps(truncated, _mm_and_ps(_mm_cmpgt_ps(truncated, v), _mm_set1_ps(1.0f)));
+}
+
+// fetch_texel()'s clamp or wrap of whole texel coordinates, 4 at a time.
+static __m128 address4(__m128 coord, int size, bool clip)
+{
+	const __m128 zero = _mm_setzero_ps(), extent = _mm_set1_ps(float(size));
+	if(clip)
+		return _mm_min_ps(_mm_max_ps(coord, zero), _mm_set1_ps(float(size - 1)));
+
+	__m128 wraps = floor4(_mm_mul_ps(coord, _mm_set1_ps(1.0f / float(size))));
+	__m128 wrapped = _mm_sub_ps(coord, _mm_mul_ps(wraps, extent));
+	// the rounded reciprocal can leave exact multiples one period off
+	wrapped = _mm_sub_ps(wrapped, _mm_and_ps(_mm_cmpge_ps(wrapped, extent), extent));
+	return _mm_add_ps(wrapped, _mm_and_ps(_mm_cmplt_ps(wrapped, zero), extent));
+}
+
+// Nearest sample_sprite() for 4 pixels, as unorm channels. Only the lanes in
+// `mask` are fetched, the rest read as 0.
+static void sample_nearest4(const SoftwareTexture& texture, __m128 u, __m128 v, int mask, __m128 out[4])
+{
+	__m128 x = address4(floor4(_mm_mul_ps(u, _mm_set1_ps(float(texture.width)))), texture.width, texture.clip);
+	__m128 y = address4(floor4(_mm_mul_ps(v, _mm_set1_ps(float(texture.height)))), texture.height, texture.clip);
+
+	alignas(16) int32_t xs[4], ys[4];
+	alignas(16) uint32_t texels[4] = {};
+	_mm_store_si128((__m128i*) xs, _mm_cvttps_epi32(x));
+	_mm_store_si128((__m128i*) ys, _mm_cvttps_epi32(y));
+
+	// no gathers before AVX2
+	for(int i=0; i<4; i++) {
+		if(mask & (1 << i))
+			texels[i] = texture.texels[size_t(ys[i]) * texture.width + xs[i]];
+	}
+
+	const __m128i c = _mm_load_si128((const __m128i*) texels);
+	const __m128i byte_mask = _mm_set1_epi32(0xFF);
+	const __m128 to_unorm = _mm_set1_ps(1.0f / 255.0f);
+	out[0] = _mm_mul_ps(_mm_cvtepi32_ps(_mm_and_si128(c, byte_mask)), to_unorm);
+	out[1] = _mm_mul_ps(_mm_cvtepi32_ps(_mm_and_si128(_mm_srli_epi32(c, 8), byte_mask)), to_unorm);
+	out[2] = _mm_mul_ps(_mm_cvtepi32_ps(_mm_and_si128(_mm_srli_epi32(c, 16), byte_mask)), to_unorm);
+	out[3] = _mm_mul_ps(_mm_cvtepi32_ps(_mm_srli_epi32(c, 24)), to_unorm);
+}
+#endif
+
+static uint32_t blend_pixel(uint32_t dst, const float src[4])
+{
+	float d[4];
+	unpack_rgba8(dst, d);
+
+	const float a = src[3], inv = 1.0f - a;
+	return pack_rgba8(src[0] * a + d[0] * inv, src[1] * a + d[1] * inv,
+	                  src[2] * a + d[2] * inv, src[3] * a + d[3] * inv);
+}
+
+//======================================================================//
+//                           TILE RASTERIZING                           //
+//======================================================================//
+
+void SoftwareRasterizer::_raster_primitive(const Primitive& p, int x0, int y0, int x1, int y1)
+{
+	for(int y=y0; y<y1; y++) {
+		uint32_t* row = pixels.data() + size_t(y) * width;
+		const float dy = float(y) + 0.5f - p.origin.y;
+		const float s_row = p.inverse[1] * dy, t_row = p.inverse[3] * dy;
+		int x = x0;
+
+#if defined(SOFTWARE_RASTER_SSE2)
+		const __m128 lane = _mm_setr_ps(0.5f, 1.5f, 2.5f, 3.5f);
+		const __m128 zero = _mm_setzero_ps(), one = _mm_set1_ps(1.0f), two = _mm_set1_ps(2.0f);
+		const __m128 sign = _mm_set1_ps(-0.0f);
+		const __m128 s_dx = _mm_set1_ps(p.inverse[0]), t_dx = _mm_set1_ps(p.inverse[2]);
+		const __m128 s_base = _mm_set1_ps(s_row), t_base = _mm_set1_ps(t_row);
+		const __m128i byte_mask = _mm_set1_epi32(0xFF);
+		const __m128 to_unorm = _mm_set1_ps(1.0f / 255.0f), to_byte = _mm_set1_ps(255.0f);
+
+		for(; x + 4 <= x1; x += 4) {
+			__m128 dx = _mm_add_ps(_mm_set1_ps(float(x) - p.origin.x), lane);
+			__m128 s = _mm_add_ps(_mm_mul_ps(s_dx, dx), s_base);
+			__m128 t = _mm_add_ps(_mm_mul_ps(t_dx, dx), t_base);
+
+			__m128 inside = _mm_and_ps(_mm_and_ps(_mm_cmpge_ps(s, zero), _mm_cmplt_ps(s, one)),
+			                           _mm_and_ps(_mm_cmpge_ps(t, zero), _mm_cmplt_ps(t, one)));
+			if(p.kind == PRIMITIVE_BOX) {
+				__m128 lx = _mm_mul_ps(_mm_andnot_ps(sign, _mm_sub_ps(_mm_mul_ps(s, two), one)),
+				                       _mm_set1_ps(p.half_extent.x));
+				__m128 ly = _mm_mul_ps(_mm_andnot_ps(sign, _mm_sub_ps(_mm_mul_ps(t, two), one)),
+				                       _mm_set1_ps(p.half_extent.y));
+				__m128 hole = _mm_and_ps(_mm_cmplt_ps(lx, _mm_set1_ps(p.inner_extent.x)),
+				                         _mm_cmplt_ps(ly, _mm_set1_ps(p.inner_extent.y)));
+				inside = _mm_andnot_ps(hole, inside);
+			}
+
+			const int mask = _mm_movemask_ps(inside);
+			if(!mask) continue;
+
+			__m128 sr = _mm_set1_ps(p.color.x), sg = _mm_set1_ps(p.color.y);
+			__m128 sb = _mm_set1_ps(p.color.z), sa = _mm_set1_ps(p.color.w);
+			if(p.kind == PRIMITIVE_SPRITE) {
+				const SoftwareTexture& texture = *p.texture;
+				__m128 u = _mm_add_ps(_mm_set1_ps(p.uv_min.x), _mm_mul_ps(s, _mm_set1_ps(p.uv_max.x - p.uv_min.x)));
+				__m128 v = _mm_add_ps(_mm_set1_ps(p.uv_min.y), _mm_mul_ps(t, _mm_set1_ps(p.uv_max.y - p.uv_min.y)));
+
+				__m128 texel[4];
+				if(!texture.linear) {
+					sample_nearest4(texture, u, v, mask, texel);
+				}
+				else {
+					// the edge-aware bilinear filter stays per lane
+					alignas(16) float us[4], vs[4], r[4] = {}, g[4] = {}, b[4] = {}, a[4] = {};
+					_mm_store_ps(us, u);
+					_mm_store_ps(vs, v);
+					for(int i=0; i<4; i++) {
+						if(!(mask & (1 << i))) continue;
+						float c[4];
+						sample_sprite(texture, p.size, us[i], vs[i], c);
+						r[i] = c[0]; g[i] = c[1]; b[i] = c[2]; a[i] = c[3];
+					}
+					texel[0] = _mm_load_ps(r); texel[1] = _mm_load_ps(g);
+					texel[2] = _mm_load_ps(b); texel[3] = _mm_load_ps(a);
+				}
+
+				sr = _mm_mul_ps(sr, texel[0]); sg = _mm_mul_ps(sg, texel[1]);
+				sb = _mm_mul_ps(sb, texel[2]); sa = _mm_mul_ps(sa, texel[3]);
+			}
+
+			__m128i dst = _mm_loadu_si128((const __m128i*) (row + x));
+			__m128 dr = _mm_mul_ps(_mm_cvtepi32_ps(_mm_and_si128(dst, byte_mask)), to_unorm);
+			__m128 dg = _mm_mul_ps(_mm_cvtepi32_ps(_mm_and_si128(_mm_srli_epi32(dst, 8), byte_mask)), to_unorm);
+			__m128 db = _mm_mul_ps(_mm_cvtepi32_ps(_mm_and_si128(_mm_srli_epi32(dst, 16), byte_mask)), to_unorm);
+			__m128 da = _mm_mul_ps(_mm_cvtepi32_ps(_mm_srli_epi32(dst, 24)), to_unorm);
+
+			__m128 inv = _mm_sub_ps(one, sa);
+			auto blend = [&](__m128 src, __m128 d) {
+				__m128 v = _mm_add_ps(_mm_mul_ps(src, sa), _mm_mul_ps(d, inv));
+				v = _mm_min_ps(_mm_max_ps(v, zero), one);
+				return _mm_cvtps_epi32(_mm_mul_ps(v, to_byte));
+			};
+
+			__m128i out = _mm_or_si128(
+				_mm_or_si128(blend(sr, dr), _mm_slli_epi32(blend(sg, dg), 8)),
+				_mm_or_si128(_mm_slli_epi32(blend(sb, db), 16), _mm_slli_epi32(blend(sa, da), 24)));
+
+			__m128i keep = _mm_castps_si128(inside);
+			out = _mm_or_si128(_mm_and_si128(keep, out), _mm_andnot_si128(keep, dst));
+			_mm_storeu_si128((__m128i*) (row + x), out);
+		}
+#endif
+
+		for(; x < x1; x++) {
+			const float dx = float(x) + 0.5f - p.origin.x;
+			const float s = p.inverse[0] * dx + s_row;
+			const float t = p.inverse[2] * dx + t_row;
+			if(!_covers(p, s, t)) continue;
+
+			float color[4];
+			_shade(p, s, t, color);
+			row[x] = blend_pixel(row[x], color);
+		}
+	}
+}
+
+void SoftwareRasterizer::_raster_tile(int tile)
+{
+	const int x0 = (tile % tiles_x) * TILE_SIZE, y0 = (tile / tiles_x) * TILE_SIZE;
+	const int x1 = std::min(x0 + TILE_SIZE, width), y1 = std::min(y0 + TILE_SIZE, height);
+
+	for(uint32_t index : bins[tile]) {
+		const Primitive& p = primitives[index];
+		_raster_primitive(p, std::max(x0, p.min_x), std::max(y0, p.min_y),
+		                     std::min(x1, p.max_x), std::min(y1, p.max_y));
+	}
+}
+
+void SoftwareRasterizer::_run_tiles()
+{
+	const int tile_count = tiles_x * tiles_y;
+	for(int tile = next_tile.fetch_add(1); tile < tile_count; tile = next_tile.fetch_add(1)) {
+		if(!bins[tile].empty())
+			_raster_tile(tile);
+	}
+}
+
+void SoftwareRasterizer::_worker_main()
+{
+	uint64_t seen = 0;
+	for(;;) {
+		{
+			std::unique_lock<std::mutex> lock(job_mutex);
+			job_start.wait(lock, [&] { return stopping || job_generation != seen; });
+			if(stopping) return;
+			seen = job_generation;
+		}
+
+		_run_tiles();
+
+		std::lock_guard<std::mutex> lock(job_mutex);
+		if(--active_workers == 0)
+			job_done.notify_one();
+	}
+}
+
+void SoftwareRasterizer::flush()
+{
+	if(primitives.empty()) return;
+
+	next_tile = 0;
+	{
+		std::lock_guard<std::mutex> lock(job_mutex);
+		job_generation++;
+		active_workers = unsigned(workers.size());
+	}
+	job_start.notify_all();
+
+	_run_tiles();
+
+	{
+		std::unique_lock<std::mutex> lock(job_mutex);
+		job_done.wait(lock, [&] { return active_workers == 0; });
+	}
+
+	primitives.clear();
+	for(std::vector<uint32_t>& bin : bins)
+		bin.clear();
+}
@@ -1,101 +1,244 @@
 #include "../sprite_batch.hpp"
+#include "../gl_state.hpp"
+#include "../quad_mesh.hpp"
 #include <iostream>
+#include <algorithm>
+#include <cstring>
+#include <vector>
 #include <glad/glad.h>
 
-SpriteBatch::SpriteBatch() 
+SpriteBatch::SpriteBatch(SpriteFormat format)
+: format(format), stride(format == SpriteFormat::PACKED ? sizeof(PackedSprite) : sizeof(Sprite))
 {
 	_init();
 }
 
 SpriteBatch::~SpriteBatch()
 {
-	glDeleteVertexArrays(1, &vao);
-	glDeleteBuffers(1, &quad_vbo);
-	glDeleteBuffers(1, &instance_vbo);
-	glDeleteBuffers(1, &ebo);
+	for(size_t i=0; i<RING_REGIONS; i++) {
+		if(region_fences[i])
+			glDeleteSync((GLsync) region_fences[i]);
+	}
+
+	gl_delete_vertex_array(vao);
+	gl_delete_buffer(quad_vbo);
+	gl_delete_buffer(instance_vbo);
+	gl_delete_buffer(ebo);
 }
 
 void SpriteBatch::begin()
 {
 	sprite_count = 0;
+
+	if(streaming) {
+		region = (region + 1) % RING_REGIONS;
+		_wait_region(region);
+		write_data = mapped_data + region * MAX_SPRITES * stride;
+	}
 }
 
 bool SpriteBatch::add(const Sprite& sprite) 
 {
 	if(sprite_count >= MAX_SPRITES) return false;
-	instance_data[sprite_count++] = sprite;
+	_write(sprite_count++, sprite);
 	return true;
 }
 
+// Copies as many sprites as fit in the current batch, returns how many were taken.
+size_t SpriteBatch::addRange(const Sprite* sprites, size_t count)
+{
+	size_t taken = std::min(count, MAX_SPRITES - sprite_count);
+
+	if(format == SpriteFormat::FULL) {
+		std::memcpy(write_data + sprite_count * stride, sprites, taken * sizeof(Sprite));
+	}
+	else {
+		for(size_t i=0; i<taken; i++)
+			_write(sprite_count + i, sprites[i]);
+	}
+
+	sprite_count += taken;
+	return taken;
+}
+
 void SpriteBatch::end() 
 {
-	glBindBuffer(GL_ARRAY_BUFFER, instance_vbo);
-	glBufferSubData(GL_ARRAY_BUFFER, 0, sprite_count * sizeof(Sprite), instance_data.data());
+	if(streaming) return;
+
+	gl_bind_buffer(GL_ARRAY_BUFFER, instance_vbo);
+	glBufferSubData(GL_ARRAY_BUFFER, 0, sprite_count * stride, instance_data.data());
 }
 
 void SpriteBatch::drawBatch() 
 {
 	if (sprite_count == 0) return;
 
-	glBindVertexArray(vao);
-	glDrawElementsInstanced(GL_TRIANGLES, 6, GL_UNSIGNED_INT, 0, sprite_count);
-	glBindVertexArray(0);
+	gl_bind_vertex_array(vao);
+	if(streaming) {
+		glDrawElementsInstancedBaseInstance(GL_TRIANGLES, 6, GL_UNSIGNED_INT, 0, 
+		                                    sprite_count, region * MAX_SPRITES);
+		region_fences[region] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+	}
+	else {
+		glDrawElementsInstanced(GL_TRIANGLES, 6, GL_UNSIGNED_INT, 0, sprite_count);
+	}
 }
 
-void SpriteBatch::_init() 
+static uint16_t pack_unorm16(float v)
 {
-	float quad_vertices[] = {
-		0, 0,
-		1, 0,
-		1, 1,
-		0, 1,
-	};
+	return uint16_t(clamp(0.0f, 1.0f, v) * 65535.0f + 0.5f);
+}
+
+static uint8_t pack_unorm8(float v)
+{
+	return uint8_t(clamp(0.0f, 1.0f, v) * 255.0f + 0.5f);
+}
 
-	unsigned int quad_indices[] = {
-		0, 1, 2, 2, 3, 0,
+static PackedSprite pack_sprite(const Sprite& sprite)
+{
+	return PackedSprite {
+		.position = sprite.position,
+		.size = sprite.size,
+		.uvmin = { pack_unorm16(sprite.uvmin.x), pack_unorm16(sprite.uvmin.y) },
+		.uvmax = { pack_unorm16(sprite.uvmax.x), pack_unorm16(sprite.uvmax.y) },
+		.color = { pack_unorm8(sprite.color.x), pack_unorm8(sprite.color.y), 
+		           pack_unorm8(sprite.color.z), pack_unorm8(sprite.color.w) },
+		.texid = uint16_t(sprite.texid),
+		.padding = 0
 	};
+}
+
+void SpriteBatch::_write(size_t index, const Sprite& sprite)
+{
+	unsigned char* dst = write_data + index * stride;
 
-	glGenVertexArrays(1, &vao);
-	glBindVertexArray(vao);
+	if(format == SpriteFormat::FULL) {
+		std::memcpy(dst, &sprite, sizeof(Sprite));
+		return;
+	}
 
-	glGenBuffers(1, &quad_vbo);
-	glBindBuffer(GL_ARRAY_BUFFER, quad_vbo);
-	glBufferData(GL_ARRAY_BUFFER, sizeof(quad_vertices), quad_vertices, GL_STATIC_DRAW);
+	PackedSprite packed = pack_sprite(sprite);
+	std::memcpy(dst, &packed, sizeof(PackedSprite));
+}
 
-	glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, 2 * sizeof(float), (void*) 0);
-	glEnableVertexAttribArray(0);
+void SpriteBatch::_wait_region(size_t index)
+{
+	GLsync fence = (GLsync) region_fences[index];
+	if(!fence) return;
 
-	glGenBuffers(1, &ebo);
-	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ebo);
-	glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(quad_indices), quad_indices, GL_STATIC_DRAW);
+	GLenum result = glClientWaitSync(fence, 0, 0);
+	while(result == GL_TIMEOUT_EXPIRED) {
+		result = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000);
+	}
+
+	glDeleteSync(fence);
+	region_fences[index] = nullptr;
+}
+
+// Per-instance attributes 1-6 for the buffer bound to GL_ARRAY_BUFFER.
+static void setup_instance_attributes(SpriteFormat format)
+{
+	if(format == SpriteFormat::FULL) {
+		glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, sizeof(Sprite), (void*)offsetof(Sprite, position));
+		glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, sizeof(Sprite), (void*)offsetof(Sprite, size));
+		glVertexAttribPointer(3, 2, GL_FLOAT, GL_FALSE, sizeof(Sprite), (void*)offsetof(Sprite, uvmin));
+		glVertexAttribPointer(4, 2, GL_FLOAT, GL_FALSE, sizeof(Sprite), (void*)offsetof(Sprite, uvmax));
+		glVertexAttribPointer(5, 4, GL_FLOAT, GL_FALSE, sizeof(Sprite), (void*)offsetof(Sprite, color));
+		glVertexAttribPointer(6, 1, GL_FLOAT, GL_FALSE, sizeof(Sprite), (void*)offsetof(Sprite, texid));
+	}
+	else {
+		glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, sizeof(PackedSprite), (void*)offsetof(PackedSprite, position));
+		glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, sizeof(PackedSprite), (void*)offsetof(PackedSprite, size));
+		glVertexAttribPointer(3, 2, GL_UNSIGNED_SHORT, GL_TRUE, sizeof(PackedSprite), (void*)offsetof(PackedSprite, uvmin));
+		glVertexAttribPointer(4, 2, GL_UNSIGNED_SHORT, GL_TRUE, sizeof(PackedSprite), (void*)offsetof(PackedSprite, uvmax));
+		glVertexAttribPointer(5, 4, GL_UNSIGNED_BYTE, GL_TRUE, sizeof(PackedSprite), (void*)offsetof(PackedSprite, color));
+		glVertexAttribPointer(6, 1, GL_UNSIGNED_SHORT, GL_FALSE, sizeof(PackedSprite), (void*)offsetof(PackedSprite, texid));
+	}
+
+	for(unsigned int attribute = 1; attribute <= 6; attribute++) {
+		glEnableVertexAttribArray(attribute);
+		glVertexAttribDivisor(attribute, 1);
+	}
+}
+
+void SpriteBatch::_init() 
+{
+	create_quad_vao(vao, quad_vbo, ebo);
+
+	glGenBuffers(1, &instance_vbo);
+	gl_bind_buffer(GL_ARRAY_BUFFER, instance_vbo);
+
+	if(GLAD_GL_VERSION_4_4) {
+		GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+		GLsizeiptr ring_size = RING_REGIONS * MAX_SPRITES * stride;
+		glBufferStorage(GL_ARRAY_BUFFER, ring_size, nullptr, flags);
+		mapped_data = (unsigned char*) glMapBufferRange(GL_ARRAY_BUFFER, 0, ring_size, flags);
+		streaming = mapped_data != nullptr;
+
+		if(!streaming) {
+			// immutable storage can't be respecified, start over with a plain buffer
+			gl_delete_buffer(instance_vbo);
+			glGenBuffers(1, &instance_vbo);
+			gl_bind_buffer(GL_ARRAY_BUFFER, instance_vbo);
+		}
+	}
+
+	if(!streaming) {
+		glBufferData(GL_ARRAY_BUFFER, MAX_SPRITES * stride, nullptr, GL_DYNAMIC_DRAW);
+		std::cout << "SpriteBatch: buffer storage unavailable, using glBufferSubData uploads\n";
+	}
+	write_data = streaming ? mapped_data : (unsigned char*) instance_data.data();
+
+	setup_instance_attributes(format);
+
+	gl_bind_vertex_array(0);
+}
+
+//======================================================================//
+//                       RETAINED STATIC SPRITES                        //
+//======================================================================//
+
+StaticSpriteBatch::StaticSpriteBatch(const Sprite* sprites, size_t count, SpriteFormat format)
+: sprite_count(count)
+{
+	create_quad_vao(vao, quad_vbo, ebo);
+
+	std::vector<PackedSprite> packed;
+	const void* data = sprites;
+	size_t size = count * sizeof(Sprite);
+
+	if(format == SpriteFormat::PACKED) {
+		packed.resize(count);
+		for(size_t i=0; i<count; i++)
+			packed[i] = pack_sprite(sprites[i]);
+		data = packed.data();
+		size = count * sizeof(PackedSprite);
+	}
 
 	glGenBuffers(1, &instance_vbo);
-	glBindBuffer(GL_ARRAY_BUFFER, instance_vbo);
-	glBufferData(GL_ARRAY_BUFFER, MAX_SPRITES * sizeof(Sprite), nullptr, GL_DYNAMIC_DRAW);
-
-	glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, sizeof(Sprite), (void*)offsetof(Sprite, position));
-	glEnableVertexAttribArray(1);
-	glVertexAttribDivisor(1, 1);
-
-	glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, sizeof(Sprite), (void*)offsetof(Sprite, size));
-	glEnableVertexAttribArray(2);
-	glVertexAttribDivisor(2, 1);
-
-	glVertexAttribPointer(3, 2, GL_FLOAT, GL_FALSE, sizeof(Sprite), (void*)offsetof(Sprite, uvmin));
-	glEnableVertexAttribArray(3);
-	glVertexAttribDivisor(3, 1);
-
-	glVertexAttribPointer(4, 2, GL_FLOAT, GL_FALSE, sizeof(Sprite), (void*)offsetof(Sprite, uvmax));
-	glEnableVertexAttribArray(4);
-	glVertexAttribDivisor(4, 1);
-
-	glVertexAttribPointer(5, 4, GL_FLOAT, GL_FALSE, sizeof(Sprite), (void*)offsetof(Sprite, color));
-	glEnableVertexAttribArray(5);
-	glVertexAttribDivisor(5, 1);
-
-	glVertexAttribPointer(6, 1, GL_FLOAT, GL_FALSE, sizeof(Sprite), (void*)offsetof(Sprite, texid));
-	glEnableVertexAttribArray(6);
-	glVertexAttribDivisor(6, 1);
-	
-	glBindVertexArray(0);
+	gl_bind_buffer(GL_ARRAY_BUFFER, instance_vbo);
+	if(GLAD_GL_VERSION_4_4)
+		glBufferStorage(GL_ARRAY_BUFFER, std::max<size_t>(size, 1), data, 0);
+	else
+		glBufferData(GL_ARRAY_BUFFER, size, data, GL_STATIC_DRAW);
+
+	setup_instance_attributes(format);
+
+	gl_bind_vertex_array(0);
+}
+
+StaticSpriteBatch::~StaticSpriteBatch()
+{
+	gl_delete_vertex_array(vao);
+	gl_delete_buffer(quad_vbo);
+	gl_delete_buffer(instance_vbo);
+	gl_delete_buffer(ebo);
+}
+
+void StaticSpriteBatch::drawBatch()
+{
+	if (sprite_count == 0) return;
+
+	gl_bind_vertex_array(vao);
+	glDrawElementsInstanced(GL_TRIANGLES, 6, GL_UNSIGNED_INT, 0, sprite_count);
 }
@@ -0,0 +1,179 @@
+#include "../texture_upload.hpp"
+#include "../gl_state.hpp"
+#include <algorithm>
+#include <cstring>
+#include <glad/glad.h>
+
+TextureUploader::TextureUploader(size_t budget)
+: budget(std::max<size_t>(budget, 1))
+{
+	_create_buffer();
+}
+
+TextureUploader::~TextureUploader()
+{
+	_destroy_buffer();
+}
+
+void TextureUploader::queue(unsigned int texture, const unsigned char* pixels,
+                            int width, int height, int channels)
+{
+	if(!texture || !pixels || width <= 0 || height <= 0 || channels <= 0) return;
+
+	cancel(texture);
+
+	PendingUpload& upload = uploads.emplace_back();
+	upload.texture = texture;
+	upload.width = width;
+	upload.height = height;
+	upload.channels = channels;
+	upload.next_row = 0;
+	upload.pixels.assign(pixels, pixels + size_t(width) * height * channels);
+}
+
+void TextureUploader::cancel(unsigned int texture)
+{
+	std::erase_if(uploads, [texture](const PendingUpload& upload) { return upload.texture == texture; });
+}
+
+bool TextureUploader::isPending(unsigned int texture) const
+{
+	for(const PendingUpload& upload : uploads) {
+		if(upload.texture == texture) return true;
+	}
+	return false;
+}
+
+void TextureUploader::update()
+{
+	if(uploads.empty()) return;
+
+	if(streaming) {
+		region = (region + 1) % RING_REGIONS;
+		_wait_region(region);
+	}
+
+	gl_bind_buffer(GL_PIXEL_UNPACK_BUFFER, pbo);
+	if(!streaming) {
+		// orphan last update's slices instead of waiting on them
+		glBufferData(GL_PIXEL_UNPACK_BUFFER, budget, nullptr, GL_STREAM_DRAW);
+	}
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+
+	const size_t region_offset = streaming ? region * budget : 0;
+	size_t used = 0;
+
+	while(!uploads.empty()) {
+		PendingUpload& upload = uploads.front();
+		const size_t row_bytes = size_t(upload.width) * upload.channels;
+		const unsigned char* source = upload.pixels.data() + upload.next_row * row_bytes;
+		int rows = int(std::min<size_t>(upload.height - upload.next_row, (budget - used) / row_bytes));
+
+		if(rows > 0) {
+			size_t size = rows * row_bytes;
+			if(streaming)
+				std::memcpy(mapped_data + region_offset + used, source, size);
+			else
+				glBufferSubData(GL_PIXEL_UNPACK_BUFFER, used, size, source);
+
+			_upload_rows(upload, rows, (const void*) (region_offset + used));
+			used += size;
+		}
+		else if(used == 0) {
+			// a row wider than the whole budget goes straight from client memory
+			gl_bind_buffer(GL_PIXEL_UNPACK_BUFFER, 0);
+			_upload_rows(upload, 1, source);
+			gl_bind_buffer(GL_PIXEL_UNPACK_BUFFER, pbo);
+			used = budget;
+		}
+		else {
+			break;
+		}
+
+		if(upload.next_row == upload.height) {
+			glGenerateMipmap(GL_TEXTURE_2D);
+			uploads.pop_front();
+		}
+	}
+
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+	gl_bind_buffer(GL_PIXEL_UNPACK_BUFFER, 0);
+
+	if(streaming)
+		region_fences[region] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+}
+
+void TextureUploader::setBudget(size_t new_budget)
+{
+	new_budget = std::max<size_t>(new_budget, 1);
+	if(new_budget == budget) return;
+
+	_destroy_buffer();
+	budget = new_budget;
+	_create_buffer();
+}
+
+// Leaves the texture bound to unit 0, for the mipmap generation after the last slice.
+void TextureUploader::_upload_rows(PendingUpload& upload, int rows, const void* source)
+{
+	GLenum format = (upload.channels == 4) ? GL_RGBA :
+		(upload.channels == 3) ? GL_RGB  :
+		(upload.channels == 2) ? GL_RG   :
+		GL_RED;
+
+	gl_bind_texture(0, GL_TEXTURE_2D, upload.texture);
+	glTexSubImage2D(GL_TEXTURE_2D, 0, 0, upload.next_row, upload.width, rows,
+	                format, GL_UNSIGNED_BYTE, source);
+	upload.next_row += rows;
+}
+
+void TextureUploader::_wait_region(size_t index)
+{
+	GLsync fence = (GLsync) region_fences[index];
+	if(!fence) return;
+
+	GLenum result = glClientWaitSync(fence, 0, 0);
+	while(result == GL_TIMEOUT_EXPIRED) {
+		result = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000);
+	}
+
+	glDeleteSync(fence);
+	region_fences[index] = nullptr;
+}
+
+void TextureUploader::_create_buffer()
+{
+	glGenBuffers(1, &pbo);
+	gl_bind_buffer(GL_PIXEL_UNPACK_BUFFER, pbo);
+
+	if(GLAD_GL_VERSION_4_4) {
+		GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+		GLsizeiptr ring_size = RING_REGIONS * budget;
+		glBufferStorage(GL_PIXEL_UNPACK_BUFFER, ring_size, nullptr, flags);
+		mapped_data = (unsigned char*) glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, ring_size, flags);
+		streaming = mapped_data != nullptr;
+
+		if(!streaming) {
+			// immutable storage can't be respecified, start over with a plain buffer
+			gl_delete_buffer(pbo);
+			glGenBuffers(1, &pbo);
+		}
+	}
+
+	gl_bind_buffer(GL_PIXEL_UNPACK_BUFFER, 0);
+}
+
+void TextureUploader::_destroy_buffer()
+{
+	for(size_t i=0; i<RING_REGIONS; i++) {
+		if(region_fences[i])
+			glDeleteSync((GLsync) region_fences[i]);
+		region_fences[i] = nullptr;
+	}
+
+	gl_delete_buffer(pbo);
+	pbo = 0;
+	mapped_data = nullptr;
+	streaming = false;
+	region = 0;
+}
@@ -0,0 +1,123 @@
+#include "../tilemap.hpp"
+#include "../gl_state.hpp"
+#include "../quad_mesh.hpp"
+#include <glad/glad.h>
+#include <algorithm>
+
+
+//======================================================================//
+//                         CHUNKED TILEMAP                              //
+//======================================================================//
+
+Tilemap::Tilemap(int width, int height, float tile_size, vec2 origin)
+: width(width), height(height), tile_size(tile_size), origin(origin)
+{
+	chunks_x = (width + CHUNK_TILES - 1) / CHUNK_TILES;
+	chunks_y = (height + CHUNK_TILES - 1) / CHUNK_TILES;
+	chunks.resize(size_t(chunks_x) * chunks_y);
+
+	for (Chunk& chunk : chunks) {
+		chunk.tiles.assign(CHUNK_TILES * CHUNK_TILES, 0);
+		chunk.dirty = false;
+
+		glGenTextures(1, &chunk.texture);
+		gl_bind_texture(0, GL_TEXTURE_2D, chunk.texture);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+		glTexImage2D(GL_TEXTURE_2D, 0, GL_R16UI, CHUNK_TILES, CHUNK_TILES, 0,
+		             GL_RED_INTEGER, GL_UNSIGNED_SHORT, chunk.tiles.data());
+	}
+
+	create_quad_vao(vao, quad_vbo, ebo);
+
+	gl_bind_vertex_array(0);
+}
+
+Tilemap::~Tilemap()
+{
+	for (Chunk& chunk : chunks)
+		gl_delete_texture(chunk.texture);
+
+	gl_delete_vertex_array(vao);
+	gl_delete_buffer(quad_vbo);
+	gl_delete_buffer(ebo);
+}
+
+void Tilemap::setTile(int x, int y, uint16_t tile)
+{
+	if (x < 0 || y < 0 || x >= width || y >= height) return;
+
+	Chunk& chunk = chunks[size_t(y / CHUNK_TILES) * chunks_x + x / CHUNK_TILES];
+	int cx = x % CHUNK_TILES, cy = y % CHUNK_TILES;
+
+	uint16_t& cell = chunk.tiles[cy * CHUNK_TILES + cx];
+	if (cell == tile) return;
+	cell = tile;
+
+	if (!chunk.dirty) {
+		chunk.dirty = true;
+		chunk.dirty_min_x = chunk.dirty_max_x = cx;
+		chunk.dirty_min_y = chunk.dirty_max_y = cy;
+	} else {
+		chunk.dirty_min_x = std::min(chunk.dirty_min_x, cx);
+		chunk.dirty_min_y = std::min(chunk.dirty_min_y, cy);
+		chunk.dirty_max_x = std::max(chunk.dirty_max_x, cx);
+		chunk.dirty_max_y = std::max(chunk.dirty_max_y, cy);
+	}
+}
+
+uint16_t Tilemap::getTile(int x, int y) const
+{
+	if (x < 0 || y < 0 || x >= width || y >= height) return 0;
+
+	const Chunk& chunk = chunks[size_t(y / CHUNK_TILES) * chunks_x + x / CHUNK_TILES];
+	return chunk.tiles[(y % CHUNK_TILES) * CHUNK_TILES + x % CHUNK_TILES];
+}
+
+void Tilemap::upload()
+{
+	bool any_dirty = false;
+
+	for (Chunk& chunk : chunks) {
+		if (!chunk.dirty) continue;
+
+		if (!any_dirty) {
+			glPixelStorei(GL_UNPACK_ROW_LENGTH, CHUNK_TILES);
+			glPixelStorei(GL_UNPACK_ALIGNMENT, 2);
+			any_dirty = true;
+		}
+
+		int w = chunk.dirty_max_x - chunk.dirty_min_x + 1;
+		int h = chunk.dirty_max_y - chunk.dirty_min_y + 1;
+		const uint16_t* first = chunk.tiles.data() + chunk.dirty_min_y * CHUNK_TILES + chunk.dirty_min_x;
+
+		gl_bind_texture(0, GL_TEXTURE_2D, chunk.texture);
+		glTexSubImage2D(GL_TEXTURE_2D, 0, chunk.dirty_min_x, chunk.dirty_min_y, w, h,
+		                GL_RED_INTEGER, GL_UNSIGNED_SHORT, first);
+		chunk.dirty = false;
+	}
+
+	if (any_dirty) {
+		glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
+		glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+	}
+}
+
+void Tilemap::getChunkBounds(size_t index, vec2& min, vec2& size, vec2& tiles) const
+{
+	int cx = int(index % chunks_x), cy = int(index / chunks_x);
+	tiles = vec2(float(std::min(CHUNK_TILES, width  - cx * CHUNK_TILES)),
+	             float(std::min(CHUNK_TILES, height - cy * CHUNK_TILES)));
+	min = origin + vec2(float(cx), float(cy)) * (CHUNK_TILES * tile_size);
+	size = tiles * tile_size;
+}
+
+void Tilemap::drawChunk(size_t index, int texture_unit)
+{
+	gl_bind_texture(texture_unit, GL_TEXTURE_2D, chunks[index].texture);
+
+	gl_bind_vertex_array(vao);
+	glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_INT, 0);
+}
@@ -8,6 +8,7 @@
 struct Window {
 	GLFWwindow* handle;
   bool running;
+  bool headless;
 };
 
 #define EVENT_QUEUE_SIZE 128
@@ -27,6 +28,9 @@ Window* window_initialize(int width, int height, const char* title, uint32_t fla
   glfwWindowHint(GLFW_TRANSPARENT_FRAMEBUFFER, flags & WINDOWFLAG_TRANSPARENT ? GLFW_TRUE : GLFW_FALSE);
   glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
 
+  // surfaceless EGL works without a display server (e.g. Mesa llvmpipe)
+  const bool headless = flags & WINDOWFLAG_HEADLESS;
+  glfwWindowHint(GLFW_CONTEXT_CREATION_API, headless ? GLFW_EGL_CONTEXT_API : GLFW_NATIVE_CONTEXT_API);
 
 #ifdef __APPLE__
   glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, GL_TRUE);
@@ -39,6 +43,7 @@ Window* window_initialize(int width, int height, const char* title, uint32_t fla
 
     return nullptr;
   }
+  result_window->headless = headless;
 
   glfwMakeContextCurrent(result_window->handle);
   
@@ -111,6 +116,10 @@ Window* window_initialize(int width, int height, const char* title, uint32_t fla
     g_EventManager.queue.push(codepoint_event);
   });
 
+  result_window->running = true;
+  if(headless)
+    return result_window;
+
   if(flags & WINDOWFLAG_CENTERED)
   {
     GLFWmonitor* monitor = glfwGetPrimaryMonitor();
@@ -124,7 +133,6 @@ Window* window_initialize(int width, int height, const char* title, uint32_t fla
 
   glfwShowWindow(result_window->handle);
 
-  result_window->running = true;
   return result_window;
 }
 
@@ -134,10 +142,23 @@ void window_destroy(Window* window) {
 }
 
 void window_swap_buffers(const Window* window) {
+  if(window->headless) return;
 
   glfwSwapBuffers(window->handle);
 }
 
+bool window_is_headless(const Window* window) {
+  return window && window->headless;
+}
+
+void window_make_context_current(const Window* window) {
+  glfwMakeContextCurrent(window->handle);
+}
+
+void window_release_context() {
+  glfwMakeContextCurrent(NULL);
+}
+
 void window_poll_events(Window* window) {
   glfwPollEvents();
 
@@ -174,3 +195,8 @@ std::pair<int,int> window_get_resolution(const Window* window) {
 	glfwGetWindowSize(window->handle, &width, &height);
 	return std::make_pair(width, height);
 }
+
+void window_set_resolution(Window* window, int width, int height) {
+	if (!window) return;
+	glfwSetWindowSize(window->handle, width, height);
+}
@@ -6,11 +6,23 @@ struct Line2D {
 	vec2 begin;
 	vec2 end;
 	vec4 color;
+	float width = 1.0f;
 };
 
-struct LineVertex2D {
-	vec2 position;
+struct Box2D {
+	vec2 min;
+	vec2 max;
 	vec4 color;
+	float width = 1.0f;
+};
+
+// One instance per segment or box outline; the vertex shader expands it into
+// a quad. Segments get square caps, so chained segments join without gaps.
+struct LineInstance2D {
+	vec2 p1, p2;
+	vec4 color;
+	float width;
+	float kind;
 };
 
 class LineBatch2D {
@@ -21,12 +33,16 @@ public:
 	void begin();
 	void end();
 	bool addLine(const Line2D& line);
+	bool addBox(const Box2D& box);
 	void drawBatch();
 
 private:
-	std::vector<LineVertex2D> vertex_array;
-	unsigned int vao, vbo;
+	std::vector<LineInstance2D> instance_array;
+	unsigned int vao, quad_vbo, instance_vbo, ebo;
 	size_t stack_top = 0;
 	bool batch_open = false;
 	const size_t BATCH_SIZE;
+
+private:
+	bool _push(const LineInstance2D& instance);
 };
@@ -0,0 +1,54 @@
+#pragma once
+#include <cstdint>
+
+// Per-pass frame profiler. Each pass is timed on the CPU (submission cost)
+// and on the GPU with GL_TIME_ELAPSED queries that are read back
+// PROFILER_LATENCY frames later, so a spike can be pinned on either side.
+// Passes must not nest (GL allows one time query at a time) and all calls
+// belong on the thread that owns the GL context.
+
+enum ProfilePass : uint8_t {
+	PROFILE_PASS_CLEAR,
+	PROFILE_PASS_LINES,
+	PROFILE_PASS_SPRITES,
+	PROFILE_PASS_TILEMAP,
+	PROFILE_PASS_UPLOAD,
+	PROFILE_PASS_BLIT,
+	PROFILE_PASS_SWAP,
+	PROFILE_PASS_COUNT,
+};
+
+// Rolling statistics over the last PROFILER_HISTORY samples, in milliseconds.
+struct ProfileTiming {
+	float cpu_avg, cpu_p95, cpu_max;
+	float gpu_avg, gpu_p95, gpu_max;
+};
+
+// Without gpu_timing (no GL context, e.g. the software renderer) only the CPU
+// side is measured and the GPU statistics stay at zero.
+void profiler_init(bool gpu_timing = true);
+void profiler_shutdown();
+void profiler_set_enabled(bool enabled);
+bool profiler_is_enabled();
+
+// Marks a frame boundary; collects the GPU results that have become available.
+void profiler_new_frame();
+
+void profiler_begin_pass(ProfilePass pass);
+void profiler_end_pass(ProfilePass pass);
+
+// Safe to call from any thread.
+ProfileTiming profiler_get_timing(ProfilePass pass);
+const char* profiler_pass_name(ProfilePass pass);
+
+// Stacked CPU (top) and GPU (bottom) bars per pass, drawn through the
+// renderer's sprite/line batches at (x, y) in world units. `ms_width` is the
+// width of one millisecond; the marker line sits at 16.6ms.
+void profiler_draw_overlay(float x, float y, float ms_width, float bar_height);
+
+struct ProfileScope {
+	ProfilePass pass;
+
+	explicit ProfileScope(ProfilePass pass) : pass(pass) { profiler_begin_pass(pass); }
+	~ProfileScope() { profiler_end_pass(pass); }
+};
@@ -0,0 +1,6 @@
+#pragma once
+
+// Creates and binds a VAO holding the shared unit quad ((0,0) to (1,1),
+// two triangles) on attribute 0, for the instanced sprite, line and tilemap
+// draws. The caller adds its own attributes and owns all three objects.
+void create_quad_vao(unsigned int& vao, unsigned int& quad_vbo, unsigned int& ebo);
@@ -0,0 +1,62 @@
+#pragma once
+#include <cstdint>
+#include <cstddef>
+#include <cstring>
+#include <utility>
+#include <vector>
+
+struct SortEntry {
+	uint64_t key;
+	uint32_t index;
+};
+
+// Float -> uint32 mapping that preserves ordering, so depth can live in the
+// low bits of an integer sort key.
+inline uint32_t radix_float_to_key(float value)
+{
+	uint32_t bits;
+	std::memcpy(&bits, &value, sizeof(bits));
+	return (bits & 0x80000000u) ? ~bits : (bits | 0x80000000u);
+}
+
+// LSD radix sort over 8-bit digits. Stable, so entries with equal keys keep
+// their submission order. Digits that are identical across every key are
+// skipped, which makes the common "mostly one layer / one texture" case cheap.
+inline void radix_sort(std::vector<SortEntry>& entries, std::vector<SortEntry>& scratch)
+{
+	const size_t count = entries.size();
+	if (count < 2) return;
+
+	size_t histogram[8][256] = {};
+	for (const SortEntry& e : entries) {
+		for (int pass = 0; pass < 8; pass++)
+			histogram[pass][(e.key >> (pass * 8)) & 0xFF]++;
+	}
+
+	scratch.resize(count);
+	SortEntry* src = entries.data();
+	SortEntry* dst = scratch.data();
+
+	for (int pass = 0; pass < 8; pass++) {
+		size_t* bucket = histogram[pass];
+		if (bucket[(src[0].key >> (pass * 8)) & 0xFF] == count)
+			continue;
+
+		size_t offset = 0;
+		for (int i = 0; i < 256; i++) {
+			size_t c = bucket[i];
+			bucket[i] = offset;
+			offset += c;
+		}
+
+		for (size_t i = 0; i < count; i++) {
+			const SortEntry& e = src[i];
+			dst[bucket[(e.key >> (pass * 8)) & 0xFF]++] = e;
+		}
+
+		std::swap(src, dst);
+	}
+
+	if (src != entries.data())
+		entries.swap(scratch);
+}
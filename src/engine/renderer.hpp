@@ -4,6 +4,8 @@
 #include "transform.hpp"
 #include "window.hpp"
 #include "image.hpp"
+#include "sprite_batch.hpp"
+#include "tilemap.hpp"
 
 struct Camera
 {
@@ -25,37 +27,175 @@ struct Texture2D {
 	unsigned int id;
 };
 
+struct TextureArray {
+	unsigned int id;
+	int width, height, layers;
+};
+
 enum TextureSpec : uint8_t {
 	TEXTURESPEC_NONE   = 0,
 	TEXTURESPEC_LINEAR = 1 << 0,
 	TEXTURESPEC_CLIP   = 1 << 1,
 };
 
-void renderer_init(const Window* window);
+enum RenderScale : uint8_t {
+	RENDERSCALE_INTEGER, // largest whole multiple that fits, letterboxed
+	RENDERSCALE_FIT,     // largest size that keeps the aspect ratio, letterboxed
+	RENDERSCALE_STRETCH, // fills the window
+};
+
+// SOFTWARE draws lines and sprites on the CPU into an RGBA8 frame (see
+// software_rasterizer.hpp) and only touches GL to present it in
+// renderer_blit(), not at all with a headless window. Static layers, tilemaps
+// and texture arrays are GL only and do nothing under it.
+enum RendererBackend : uint8_t {
+	RENDERER_BACKEND_OPENGL,
+	RENDERER_BACKEND_SOFTWARE,
+};
+
+// Counts from the most recent renderer_draw_lines/renderer_draw_sprites.
+// Anything outside an orthographic camera's view is culled before batching;
+// line counts are per line/box command.
+struct RendererStats {
+	size_t sprites_drawn, sprites_culled;
+	size_t lines_drawn, lines_culled;
+	// running totals of GL state changes sent to the driver vs filtered out
+	uint64_t gl_calls_issued, gl_calls_skipped;
+};
+
+void renderer_init(const Window* window, RendererBackend backend = RENDERER_BACKEND_OPENGL);
 void renderer_cleanup();
 void renderer_set_viewport(int x, int y);
 
+// Instance layout used to upload sprites. PACKED halves upload bandwidth but
+// clamps UVs to 0..1, so it can't be used for repeating UVs.
+void renderer_set_sprite_format(SpriteFormat format);
+
 void renderer_draw_lines(const Camera& render_cam);
 void renderer_draw_sprites(const Camera& render_cam);
 
 void renderer_clear_buffer(float r, float g, float b, float a);
 void renderer_clear_buffer(float color[4]);
 
+// Line and box widths are in world units; boxes are outlines centred on their edges.
 void renderer_add_line2d(float x1, float y1, float x2, float y2, 
-												 const Color& color = Color { 1.0f, 1.0f, 1.0f, 1.0f});
-void renderer_add_box2d(float x, float y, float w, float h, const Color& color = {1,1,1,1});
+												 const Color& color = Color { 1.0f, 1.0f, 1.0f, 1.0f}, float width = 1.0f);
+void renderer_add_box2d(float x, float y, float w, float h, const Color& color = {1,1,1,1},
+                        float width = 1.0f);
 void renderer_add_sprite(float x, float y, float w, float h, const Color& color = {1,1,1,1},
 	 int tex = 0, float uvx1 = 0.0f, float uvy1 = 0.0f, float uvx2 = 1.0f, float uvy2 = 1.0f);
 
+// Reserves `count` sprites in this frame's instance array for the caller to
+// fill in place. The pointer is valid until the next sprite submission.
+Sprite* renderer_push_sprites(size_t count);
+
+// Layer and depth applied to subsequent renderer_add_sprite() calls. Sprites are
+// drawn sorted by (layer, depth); equal keys keep submission order.
+void renderer_set_sprite_layer(uint8_t layer, float depth = 0.0f);
+
+// Render lists record draws away from the global renderer state, so worker
+// threads can each fill their own list (e.g. one per entity chunk) in parallel.
+// renderer_submit_list() is thread safe; submitted lists are merged at the next
+// renderer_draw_* call in ascending `order`, after anything added through the
+// global renderer_add_* functions. Use unique orders for deterministic output,
+// and don't touch a submitted list again until that merge has happened.
+struct RenderList;
+
+RenderList* renderer_create_list();
+void renderer_destroy_list(RenderList* list);
+
+void renderer_list_add_line2d(RenderList* list, float x1, float y1, float x2, float y2, 
+                              const Color& color = Color { 1.0f, 1.0f, 1.0f, 1.0f}, float width = 1.0f);
+void renderer_list_add_box2d(RenderList* list, float x, float y, float w, float h, 
+                             const Color& color = {1,1,1,1}, float width = 1.0f);
+void renderer_list_add_sprite(RenderList* list, float x, float y, float w, float h, 
+	const Color& color = {1,1,1,1}, int tex = 0, 
+	float uvx1 = 0.0f, float uvy1 = 0.0f, float uvx2 = 1.0f, float uvy2 = 1.0f);
+Sprite* renderer_list_push_sprites(RenderList* list, size_t count);
+void renderer_list_set_sprite_layer(RenderList* list, uint8_t layer, float depth = 0.0f);
+
+void renderer_submit_list(RenderList* list, uint32_t order);
+
+// Sprites that never change, uploaded once into their own GPU buffer and drawn
+// with one instanced call using the current camera and texture bindings.
+StaticSpriteBatch* renderer_create_static_layer(const Sprite* sprites, size_t count);
+void renderer_destroy_static_layer(StaticSpriteBatch* layer);
+void renderer_draw_static_layer(StaticSpriteBatch* layer, const Camera& camera);
+
+// Draws the chunks of `map` that overlap the camera, one quad each, after
+// re-uploading any edited cells. `tile_pixels` is the tile edge in the tileset.
+void renderer_draw_tilemap(Tilemap* map, Texture2D tileset, int tile_pixels, const Camera& camera);
+
+RendererStats renderer_get_stats();
+
 void renderer_bind_texture_slot(Texture2D texture, int slot);
 
 void renderer_clear_sprite_buffer();
 void renderer_clear_line_buffer();
 
 Texture2D renderer_load_texture(Image2D* image, TextureSpec spec);
+// With file_watch enabled the texture is re-imported in place, same id,
+// whenever the file changes.
 Texture2D renderer_load_texture(const char* path, TextureSpec spec);
 void renderer_delete_texture(Texture2D& texture);
 
+// Returns at once and uploads the pixels a row slice at a time from
+// renderer_begin(), within the per-frame byte budget. Until the last slice
+// is in, draws sample the fallback texture (plain white unless set) in its
+// place. The pixels are copied, so `image` may be freed right away. The
+// software renderer loads synchronously.
+Texture2D renderer_load_texture_async(Image2D* image, TextureSpec spec);
+bool renderer_texture_ready(Texture2D texture);
+void renderer_set_upload_budget(size_t bytes_per_frame);
+void renderer_set_fallback_texture(Texture2D texture);
+
+// Same-sized images packed as the layers of one GL_TEXTURE_2D_ARRAY. While an
+// array is in use, renderer_draw_sprites() samples it instead of the texture
+// slots and a sprite's `tex` selects the layer; pass {0} to go back to slots.
+TextureArray renderer_load_texture_array(Image2D** images, int count, TextureSpec spec);
+void renderer_delete_texture_array(TextureArray& array);
+void renderer_use_texture_array(const TextureArray& array);
+
+// Internal resolution for everything drawn between renderer_begin() and
+// renderer_end(). The frame is rendered into an offscreen width x height
+// target and renderer_blit() scales it to the window with nearest filtering.
+// 0x0 (the default) draws straight to the window.
+void renderer_set_render_resolution(int width, int height, RenderScale scale = RENDERSCALE_INTEGER);
+
+// With a WINDOWFLAG_HEADLESS window the frame always goes to an offscreen
+// target (window-sized unless a resolution is set) and renderer_blit() is a
+// no-op, so results are read back with renderer_read_pixels().
 void renderer_begin();
 void renderer_end();
 void renderer_blit(const Window* window);
+
+// Copies a rect of the last rendered frame (the offscreen target if there
+// is one, else the window) into `rgba`, bottom row first. Call after renderer_end().
+bool renderer_read_pixels(int x, int y, int width, int height, unsigned char* rgba);
+
+// Frame capture. The next renderer_begin() after renderer_capture_frame()
+// writes that frame's line/sprite commands, camera and slot textures (read
+// back from the GPU) to `path`. A loaded capture can be replayed any number
+// of times: renderer_replay_capture() queues its commands into the current
+// frame, binds its textures and returns the camera to draw it with.
+// Captures are raw struct dumps, only valid for the build that wrote them;
+// renderer_load_capture() returns nullptr for files whose counts don't add up.
+struct RenderCapture;
+
+void renderer_capture_frame(const char* path);
+RenderCapture* renderer_load_capture(const char* path);
+void renderer_destroy_capture(RenderCapture* capture);
+void renderer_get_capture_resolution(const RenderCapture* capture, int& width, int& height);
+Camera renderer_replay_capture(const RenderCapture* capture);
+
+// Frame pipelining. render_frame issues the frame's GL work (clear, draw_*,
+// blit, swap) and is handed each submitted camera. With frame_latency 0 it
+// runs inline from renderer_submit_frame(); with 1-2 a render thread takes
+// over the GL context and draws frame N while the caller records frame N+1,
+// running at most frame_latency frames ahead. While pipelined, GL resources
+// must not be created or destroyed from the calling thread.
+typedef void (*RenderFrameFn)(const Camera& camera);
+
+void renderer_pipeline_start(const Window* window, int frame_latency, RenderFrameFn render_frame);
+void renderer_pipeline_stop();
+void renderer_submit_frame(const Camera& camera);
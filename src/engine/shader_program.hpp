@@ -5,12 +5,27 @@ struct Shader {
 	unsigned int ID;
 };
 
+// Uniform location resolved from the table built when the program is linked.
+// -1 for names the program doesn't have (uploads to -1 are ignored by GL).
+typedef int UniformHandle;
+
+// Directory for linked program binaries (nullptr disables, the default).
+// Programs are looked up by source + driver and recompiled when missing or
+// rejected, so the directory can be wiped at any time.
+void shader_set_binary_cache(const char* directory);
+
 void shader_load_glsl_from_source(const char* vertex_source, const char* fragment_source, Shader& program);
+// With file_watch enabled the program is relinked in place when either file
+// changes, keeping its ID. A failed compile or link keeps the old program.
+// Relinking resets uniform values and may move locations, so re-upload and
+// re-resolve handles from a file_watch_add() callback on the same path.
 void shader_load_glsl(const char* vertexPath, const char* fragmentPath, Shader& program);
 
 void shader_use_program(const Shader& program);
 void shader_delete_program(const Shader& program);
 
+UniformHandle shader_get_uniform(const Shader& program, const char* name);
+
 void shader_upload_int(const Shader& program, const char* name, int v);
 void shader_upload_int_array(const Shader& program, const char* name, int* v, size_t size);
 void shader_upload_float(const Shader& program, const char* name, float v);
@@ -19,3 +34,13 @@ void shader_upload_vec3(const Shader& program, const char* name, float x, float
 void shader_upload_vec4(const Shader& program, const char* name, float x, float y, float z, float w);
 void shader_upload_float_array(const Shader& program, const char* name, const float* array, size_t size);
 void shader_upload_mat4(const Shader& program, const char* name, const float* mat);
+
+// Handle uploads bind `program` first, free when it's already in use.
+void shader_upload_int(const Shader& program, UniformHandle handle, int v);
+void shader_upload_int_array(const Shader& program, UniformHandle handle, int* v, size_t size);
+void shader_upload_float(const Shader& program, UniformHandle handle, float v);
+void shader_upload_vec2(const Shader& program, UniformHandle handle, float x, float y);
+void shader_upload_vec3(const Shader& program, UniformHandle handle, float x, float y, float z);
+void shader_upload_vec4(const Shader& program, UniformHandle handle, float x, float y, float z, float w);
+void shader_upload_float_array(const Shader& program, UniformHandle handle, const float* array, size_t size);
+void shader_upload_mat4(const Shader& program, UniformHandle handle, const float* mat);
@@ -1,22 +1,58 @@
 #pragma once
 
+// Each instance is a segment (kind 0) or a box outline (kind 1), expanded from
+// the unit quad. Boxes draw as one quad and discard their interior.
 const char* LINE2D_SHADER_SOURCE_V = R"(
 #version 410 core
 layout (location = 0) in vec2 aPos;
-layout (location = 1) in vec4 aColor;
+layout (location = 1) in vec2 instanceP1;
+layout (location = 2) in vec2 instanceP2;
+layout (location = 3) in vec4 instanceColor;
+layout (location = 4) in float instanceWidth;
+layout (location = 5) in float instanceKind;
 uniform mat4 uProj, uView;
 out vec4 fVertexColor;
+out vec2 fLocal;
+flat out vec2 fInnerExtent;
+flat out float fKind;
 void main() {
-	fVertexColor = aColor;
-	gl_Position = uProj * uView * vec4(aPos, 0.0, 1.0f);
+	vec2 corner = aPos * 2.0 - 1.0;
+	float halfWidth = instanceWidth * 0.5;
+	vec2 worldPos;
+
+	if (instanceKind > 0.5) {
+		vec2 center = (instanceP1 + instanceP2) * 0.5;
+		vec2 halfExtent = abs(instanceP2 - instanceP1) * 0.5 + halfWidth;
+		worldPos = center + corner * halfExtent;
+		fLocal = corner * halfExtent;
+		fInnerExtent = halfExtent - instanceWidth;
+	} else {
+		vec2 d = instanceP2 - instanceP1;
+		float len = length(d);
+		vec2 dir = len > 0.0 ? d / len : vec2(1.0, 0.0);
+		vec2 normal = vec2(-dir.y, dir.x);
+		worldPos = mix(instanceP1 - dir * halfWidth, instanceP2 + dir * halfWidth, aPos.x) 
+		         + normal * (corner.y * halfWidth);
+		fLocal = vec2(0.0);
+		fInnerExtent = vec2(-1.0);
+	}
+
+	fKind = instanceKind;
+	fVertexColor = instanceColor;
+	gl_Position = uProj * uView * vec4(worldPos, 0.0, 1.0f);
 }
 )";
 
 const char* LINE2D_SHADER_SOURCE_F = R"(
 #version 410 core
 in vec4 fVertexColor;
+in vec2 fLocal;
+flat in vec2 fInnerExtent;
+flat in float fKind;
 out vec4 fragColor;
 void main() {
+	if (fKind > 0.5 && all(lessThan(abs(fLocal), fInnerExtent)))
+		discard;
 	fragColor = fVertexColor;
 }
 )";
@@ -45,3 +45,24 @@ void main() {
 	fragColor = texture_color * fVertexColor;
 }
 )";
+
+// Same-sized sheets stored as layers of one array texture; fTexId picks the layer.
+static const char* SPRITE_ARRAY_SHADER_SOURCE_F = R"(
+#version 410 core
+in vec4 fVertexColor;
+in vec2 fTexCoords;
+flat in float fTexId;
+flat in vec2 fSpriteSize;
+out vec4 fragColor;
+uniform sampler2DArray uTextureArray;
+void main() {
+	vec2 res = textureSize(uTextureArray, 0).xy;
+	vec2 texel = 1/res;
+	vec2 pxPerTex = fSpriteSize * texel;
+	vec2 tx = fTexCoords * res;
+	vec2 txOffset = clamp(fract(tx) * pxPerTex, 0, 0.5) - clamp((1 - fract(tx)) * pxPerTex, 0, 0.5);
+	vec2 uv = (floor(tx) + 0.5 + txOffset) * texel;
+	vec4 texture_color = texture(uTextureArray, vec3(uv, fTexId));
+	fragColor = texture_color * fVertexColor;
+}
+)";
@@ -0,0 +1,36 @@
+#pragma once
+
+static const char* TILEMAP_SHADER_SOURCE_V = R"(
+#version 410 core
+layout (location = 0) in vec2 aPos;
+uniform mat4 uProj, uView;
+uniform vec2 uChunkOrigin;
+uniform vec2 uChunkSize;
+uniform vec2 uChunkTiles;
+out vec2 fTileCoord;
+void main() {
+	fTileCoord = aPos * uChunkTiles;
+	gl_Position = uProj * uView * vec4(uChunkOrigin + aPos * uChunkSize, 0.0f, 1.0f);
+}
+)";
+
+static const char* TILEMAP_SHADER_SOURCE_F = R"(
+#version 410 core
+in vec2 fTileCoord;
+out vec4 fragColor;
+uniform usampler2D uTileIndices;
+uniform sampler2D uTileset;
+uniform int uTilePixels;
+uniform vec2 uChunkTiles;
+void main() {
+	ivec2 cell = min(ivec2(floor(fTileCoord)), ivec2(uChunkTiles) - 1);
+	uint tile = texelFetch(uTileIndices, cell, 0).r;
+	if (tile == 0u) discard;
+
+	int columns = max(textureSize(uTileset, 0).x / uTilePixels, 1);
+	int index = int(tile) - 1;
+	ivec2 tileOrigin = ivec2(index % columns, index / columns) * uTilePixels;
+	ivec2 texel = tileOrigin + min(ivec2(fract(fTileCoord) * float(uTilePixels)), ivec2(uTilePixels - 1));
+	fragColor = texelFetch(uTileset, texel, 0);
+}
+)";
@@ -0,0 +1,103 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include "vmath.hpp"
+#include "sprite_batch.hpp"
+
+// RGBA8 image sampled by the software rasterizer, rows in upload order (as GL).
+struct SoftwareTexture {
+	int width = 0, height = 0;
+	bool linear = false, clip = false;
+	std::vector<uint32_t> texels;
+};
+
+// CPU counterpart of the sprite and line shaders. Primitives are transformed
+// and binned into screen tiles as they are added; flush() then rasterizes the
+// tiles on a small worker pool, each tile blending its primitives in
+// submission order (SRC_ALPHA, ONE_MINUS_SRC_ALPHA) into an RGBA8 buffer.
+// Coverage, nearest sampling, colour modulate and blending run 4 pixels wide
+// with SSE2 where available (linear filtering samples per pixel), scalar
+// otherwise.
+class SoftwareRasterizer {
+public:
+	static constexpr int TEXTURE_SLOTS = 32;
+
+	// thread_count 0 uses every hardware thread
+	explicit SoftwareRasterizer(unsigned int thread_count = 0);
+	~SoftwareRasterizer();
+
+	SoftwareRasterizer(const SoftwareRasterizer&) = delete;
+	SoftwareRasterizer& operator=(const SoftwareRasterizer&) = delete;
+
+	void resize(int width, int height);
+	void clear(const vec4& color);
+	void setCamera(const mat4& proj, const mat4& view);
+	void setTexture(int slot, const SoftwareTexture* texture);
+
+	void addSprite(const Sprite& sprite);
+	void addLine(vec2 p1, vec2 p2, const vec4& color, float width);
+	void addBox(vec2 min, vec2 max, const vec4& color, float width);
+
+	// Rasterizes everything added since the last flush.
+	void flush();
+
+	int getWidth() const { return width; }
+	int getHeight() const { return height; }
+	// bottom row first, like glReadPixels
+	const uint32_t* getPixels() const { return pixels.data(); }
+
+private:
+	static constexpr int TILE_SIZE = 64;
+
+	enum PrimitiveKind : uint8_t {
+		PRIMITIVE_SPRITE,
+		PRIMITIVE_SOLID,
+		PRIMITIVE_BOX,
+	};
+
+	// Screen-space parallelogram origin + s*axis_s + t*axis_t, s,t in [0,1).
+	struct Primitive {
+		vec2 origin;
+		float inverse[4]; // pixel offset from origin -> (s, t)
+		int min_x, min_y, max_x, max_y;
+
+		vec4 color;
+		vec2 uv_min, uv_max;
+		vec2 size;        // sprite world size, for the texel-edge filtering
+		vec2 half_extent; // box outline: outer and inner half sizes
+		vec2 inner_extent;
+		const SoftwareTexture* texture;
+		PrimitiveKind kind;
+	};
+
+	int width = 0, height = 0;
+	int tiles_x = 0, tiles_y = 0;
+	std::vector<uint32_t> pixels;
+
+	mat4 view_proj;
+	const SoftwareTexture* textures[TEXTURE_SLOTS] = {};
+
+	std::vector<Primitive> primitives;
+	std::vector<std::vector<uint32_t>> bins;
+
+	std::vector<std::thread> workers;
+	std::mutex job_mutex;
+	std::condition_variable job_start, job_done;
+	uint64_t job_generation = 0;
+	unsigned int active_workers = 0;
+	bool stopping = false;
+	std::atomic<int> next_tile{0};
+
+private:
+	void _add_quad(vec2 p0, vec2 p1, vec2 p3, Primitive primitive);
+	void _worker_main();
+	void _run_tiles();
+	void _raster_tile(int tile);
+	void _raster_primitive(const Primitive& primitive, int x0, int y0, int x1, int y1);
+	static bool _covers(const Primitive& primitive, float s, float t);
+	static void _shade(const Primitive& primitive, float s, float t, float out[4]);
+};
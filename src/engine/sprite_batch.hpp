@@ -1,5 +1,6 @@
 #pragma once
 #include <cstdlib>
+#include <cstdint>
 #include <array>
 #include "vmath.hpp"
 
@@ -11,22 +12,76 @@ struct Sprite {
 	float texid;
 };
 
+// 32 byte instance: UVs as 16-bit unorm (so they must stay within 0..1),
+// color as RGBA8 and the texture/layer index as uint16. Position and size
+// stay float to keep pixel-exact placement. The vertex fetch converts every
+// field back to float, so both formats share the sprite shaders.
+struct PackedSprite {
+	vec2 position;
+	vec2 size;
+	uint16_t uvmin[2], uvmax[2];
+	uint8_t color[4];
+	uint16_t texid;
+	uint16_t padding;
+};
+
+enum class SpriteFormat : uint8_t {
+	FULL,
+	PACKED,
+};
+
 class SpriteBatch {
 public:
-	SpriteBatch();
+	explicit SpriteBatch(SpriteFormat format = SpriteFormat::FULL);
 	~SpriteBatch();
 
 	void begin();
 	void end();
 	bool add(const Sprite& sprite);
+	size_t addRange(const Sprite* sprites, size_t count);
 	void drawBatch();
 
+	SpriteFormat getFormat() const { return format; }
+
 private:
 	static constexpr size_t MAX_SPRITES = 1024;
+	static constexpr size_t RING_REGIONS = 3;
 	std::array<Sprite, MAX_SPRITES> instance_data;
 	unsigned int vao, quad_vbo, instance_vbo, ebo;
 	size_t sprite_count = 0;
+	SpriteFormat format;
+	size_t stride;
+
+	// Streaming mode: instance_vbo is a persistently mapped ring of
+	// RING_REGIONS batches, each guarded by a fence, and add() writes
+	// straight into the mapped region. Falls back to instance_data +
+	// glBufferSubData when buffer storage is unavailable.
+	bool streaming = false;
+	unsigned char* mapped_data = nullptr;
+	unsigned char* write_data = nullptr;
+	void* region_fences[RING_REGIONS] = {};
+	size_t region = 0;
 
 private:
 	void _init();
+	void _write(size_t index, const Sprite& sprite);
+	void _wait_region(size_t index);
+};
+
+// Immutable instance buffer built once from a sprite list, for geometry that
+// never changes (tile/background layers). Drawing is a single instanced call.
+class StaticSpriteBatch {
+public:
+	StaticSpriteBatch(const Sprite* sprites, size_t count, SpriteFormat format = SpriteFormat::FULL);
+	~StaticSpriteBatch();
+
+	StaticSpriteBatch(const StaticSpriteBatch&) = delete;
+	StaticSpriteBatch& operator=(const StaticSpriteBatch&) = delete;
+
+	void drawBatch();
+	size_t getCount() const { return sprite_count; }
+
+private:
+	unsigned int vao, quad_vbo, instance_vbo, ebo;
+	size_t sprite_count;
 };
@@ -0,0 +1,57 @@
+#pragma once
+#include <cstddef>
+#include <deque>
+#include <vector>
+
+// Streams texture pixels to the GPU through pixel unpack buffers, at most
+// `budget` bytes per update() so a large load is spread over several frames
+// as row slices instead of stalling one. Textures must already have level 0
+// allocated; their mipmaps are generated once the last slice is in.
+class TextureUploader {
+public:
+	explicit TextureUploader(size_t budget);
+	~TextureUploader();
+
+	TextureUploader(const TextureUploader&) = delete;
+	TextureUploader& operator=(const TextureUploader&) = delete;
+
+	// Copies `pixels` (tightly packed rows of 1-4 channel bytes).
+	void queue(unsigned int texture, const unsigned char* pixels, int width, int height, int channels);
+	void cancel(unsigned int texture);
+	bool isPending(unsigned int texture) const;
+
+	// Issues this frame's slices, call once per frame on the GL thread.
+	void update();
+
+	void setBudget(size_t budget);
+	size_t getBudget() const { return budget; }
+
+private:
+	static constexpr size_t RING_REGIONS = 3;
+
+	struct PendingUpload {
+		unsigned int texture;
+		int width, height, channels;
+		int next_row;
+		std::vector<unsigned char> pixels;
+	};
+
+	std::deque<PendingUpload> uploads;
+	size_t budget;
+	unsigned int pbo = 0;
+
+	// Streaming mode: pbo is a persistently mapped ring of RING_REGIONS
+	// budget-sized regions, each guarded by a fence, written with memcpy.
+	// Falls back to orphaning the buffer and glBufferSubData each update
+	// when buffer storage is unavailable.
+	bool streaming = false;
+	unsigned char* mapped_data = nullptr;
+	void* region_fences[RING_REGIONS] = {};
+	size_t region = 0;
+
+private:
+	void _create_buffer();
+	void _destroy_buffer();
+	void _wait_region(size_t index);
+	void _upload_rows(PendingUpload& upload, int rows, const void* source);
+};
@@ -0,0 +1,50 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+#include "vmath.hpp"
+
+// Tile grid split into CHUNK_TILES x CHUNK_TILES chunks. Each chunk keeps its
+// tile indices in a small R16UI texture and is drawn as a single quad whose
+// fragment shader looks the tile up in the tileset. Index 0 is empty, index n
+// is tileset cell n-1 counting left to right, top to bottom.
+class Tilemap {
+public:
+	static constexpr int CHUNK_TILES = 32;
+
+	Tilemap(int width, int height, float tile_size, vec2 origin = vec2(0.0f));
+	~Tilemap();
+
+	Tilemap(const Tilemap&) = delete;
+	Tilemap& operator=(const Tilemap&) = delete;
+
+	void setTile(int x, int y, uint16_t tile);
+	uint16_t getTile(int x, int y) const;
+
+	// Re-uploads just the edited cells of each dirty chunk.
+	void upload();
+
+	int getWidth() const { return width; }
+	int getHeight() const { return height; }
+	float getTileSize() const { return tile_size; }
+
+	size_t getChunkCount() const { return chunks.size(); }
+	// World rect of chunk i and how many tiles of it are inside the map.
+	void getChunkBounds(size_t index, vec2& min, vec2& size, vec2& tiles) const;
+	// Binds chunk i's index texture to `texture_unit` and draws its quad.
+	void drawChunk(size_t index, int texture_unit);
+
+private:
+	struct Chunk {
+		std::vector<uint16_t> tiles;
+		unsigned int texture;
+		int dirty_min_x, dirty_min_y, dirty_max_x, dirty_max_y;
+		bool dirty;
+	};
+
+	int width, height;
+	int chunks_x, chunks_y;
+	float tile_size;
+	vec2 origin;
+	std::vector<Chunk> chunks;
+	unsigned int vao, quad_vbo, ebo;
+};
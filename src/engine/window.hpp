@@ -22,6 +22,8 @@ enum WindowFlags : uint8_t {
   WINDOWFLAG_UNDECORATED  = 1 << 3,
   WINDOWFLAG_CENTERED     = 1 << 4,
   WINDOWFLAG_TRANSPARENT  = 1 << 5,
+  // never shown, EGL context; the renderer draws into an offscreen target
+  WINDOWFLAG_HEADLESS     = 1 << 6,
 };
 
 struct Event {
@@ -40,6 +42,9 @@ Window* window_initialize(int width, int height, const char* title, uint32_t fla
 void window_destroy(Window* window);
 
 void window_swap_buffers(const Window* window);
+bool window_is_headless(const Window* window);
+void window_make_context_current(const Window* window);
+void window_release_context();
 void window_poll_events(Window* window);
 
 bool window_get_event(Event& e);
@@ -47,3 +52,4 @@ void window_set_title(Window* window, const char* title);
 
 void* window_get_native_handle(const Window* window); 
 std::pair<int,int> window_get_resolution(const Window* window);
+void window_set_resolution(Window* window, int width, int height);
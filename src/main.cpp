@@ -3,6 +3,9 @@
 #include "engine/renderer.hpp"
 #include "engine/input.hpp"
 #include "engine/action_map.hpp"
+#include "engine/shader_program.hpp"
+#include "engine/profiler.hpp"
+#include "engine/file_watch.hpp"
 
 #include <cstdio>
 #include <iostream>
@@ -10,6 +13,36 @@
 static Window* window = nullptr;
 static Camera camera;
 
+// 0 renders inline, 1-2 renders on a dedicated thread that many frames behind
+static constexpr int FRAME_LATENCY = 0;
+
+// offscreen resolution upscaled to the window, 0x0 renders at window size
+static constexpr int RENDER_WIDTH = 0, RENDER_HEIGHT = 0;
+
+// SOFTWARE rasterizes on the CPU, for machines with broken GL drivers
+static constexpr RendererBackend BACKEND = RENDERER_BACKEND_OPENGL;
+
+// re-import textures and shaders loaded from files when they change on disk
+static constexpr bool HOT_RELOAD = true;
+
+// per-pass CPU/GPU timing bars in the corner of the screen
+static constexpr bool SHOW_PROFILER = false;
+
+static Color clear_color;
+
+static void render_frame(const Camera& render_cam) {
+	renderer_begin();
+	renderer_clear_buffer(clear_color.r, clear_color.g, clear_color.b, clear_color.a);
+	renderer_draw_lines(render_cam);
+	renderer_draw_sprites(render_cam);
+	renderer_end();
+
+	renderer_blit(window);
+
+	ProfileScope scope(PROFILE_PASS_SWAP);
+	window_swap_buffers(window);
+}
+
 int main() {
 	bool running = true;
 
@@ -32,7 +65,11 @@ int main() {
 		}
 
 		input_set_window(window);
-		renderer_init(window);
+		file_watch_set_enabled(HOT_RELOAD);
+		shader_set_binary_cache("shader_cache");
+		renderer_init(window, BACKEND);
+		renderer_set_render_resolution(RENDER_WIDTH, RENDER_HEIGHT, RENDERSCALE_INTEGER);
+		profiler_set_enabled(SHOW_PROFILER);
 	}
 	
 	//===========================================================
@@ -54,7 +91,9 @@ int main() {
 
 	vec2 panel_pos(0.0f), panel_size(32);
 
-	const Color clear_color = color_from_hexcode("312e2f");
+	clear_color = color_from_hexcode("312e2f");
+
+	renderer_pipeline_start(window, FRAME_LATENCY, render_frame);
 
 	while(running) {
 		core_update();
@@ -69,6 +108,11 @@ int main() {
 				running = false;
 				break;
 			}
+			else if (e.type == EVENT_KEY) {
+				// F12 dumps the next frame for tools/replay
+				if(e.key_data.key == KEY_F12 && e.key_data.action == PRESS)
+					renderer_capture_frame("frame.rcap");
+			}
 			else if (e.type == EVENT_CURSOR) {
 				if(input_is_mouse_pressed(0))
 					panel_pos += vec2(e.cursor_data.delta_x, e.cursor_data.delta_y);
@@ -92,7 +136,11 @@ int main() {
 		auto [x, y] = input_get_cursor_position();
 		renderer_add_sprite(panel_pos.x, panel_pos.y, panel_size.x,panel_size.y, 
 											color_from_hexcode("ffedd4"));
-	
+
+		if(SHOW_PROFILER) {
+			auto[w, h] = window_get_resolution(window);
+			profiler_draw_overlay(-float(w)/2 + 8, -float(h)/2 + 8, 16.0f, 6.0f);
+		}
 
 		//===========================================================
 		// Game state Render
@@ -101,19 +149,11 @@ int main() {
 		camera.updateProjection();
 		camera.updateView();
 
-		renderer_begin();
-		renderer_clear_buffer(clear_color.r, clear_color.g, clear_color.b, clear_color.a);
-		renderer_draw_lines(camera);
-		renderer_draw_sprites(camera);
-		renderer_end();
-
-		renderer_blit(window);
-
 		//===========================================================
 		// Prep for next frame
 		//===========================================================
 		action_map_update(window);
-		window_swap_buffers(window);
+		renderer_submit_frame(camera);
 		window_poll_events(window);
 	}
 
@@ -0,0 +1,245 @@
+#include "engine/command_buffer.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Stress test and throughput benchmark for SPSCCommandBuffer.
+//
+//   command_ring [commands]
+//
+// The stress pass streams `commands` sequence-numbered commands from a
+// producer thread to a consumer thread with mixed batch sizes on a small
+// ring (so both sides keep hitting full/empty) and checks they arrive
+// complete and in order. The benchmark then moves the same number of
+// commands through the ring and through a mutex-guarded vector, the path
+// the ring replaces. Exits non-zero if the stress pass fails; build with
+// -fsanitize=thread to check the memory ordering as well.
+
+// Sized like a small draw command, with a checksum to catch torn copies.
+struct TestCommand {
+	uint64_t sequence;
+	uint64_t payload[6];
+	uint64_t checksum;
+};
+
+static TestCommand make_command(uint64_t sequence)
+{
+	TestCommand command;
+	command.sequence = sequence;
+	command.checksum = sequence;
+	for(int i=0; i<6; i++) {
+		command.payload[i] = sequence * 0x9E3779B97F4A7C15ull + i;
+		command.checksum ^= command.payload[i];
+	}
+	return command;
+}
+
+static bool check_command(const TestCommand& command, uint64_t expected)
+{
+	uint64_t checksum = command.sequence;
+	for(int i=0; i<6; i++)
+		checksum ^= command.payload[i];
+	return command.sequence == expected && command.checksum == checksum;
+}
+
+// The queue the ring replaces: producer appends under a lock, consumer
+// swaps the whole vector out under the same lock.
+template <typename T>
+class MutexCommandQueue {
+public:
+	size_t push_commands(const T* commands, size_t count) {
+		std::lock_guard<std::mutex> lock(mutex);
+		pending.insert(pending.end(), commands, commands + count);
+		return count;
+	}
+
+	void pop_all(std::vector<T>& commands) {
+		commands.clear();
+		std::lock_guard<std::mutex> lock(mutex);
+		commands.swap(pending);
+	}
+
+private:
+	std::mutex mutex;
+	std::vector<T> pending;
+};
+
+//======================================================================//
+//                                STRESS                                //
+//======================================================================//
+
+static bool run_stress(uint64_t count)
+{
+	// small on purpose, the interesting cases are a full or empty ring
+	static SPSCCommandBuffer<TestCommand, 64> ring;
+	uint64_t failures = 0;
+
+	std::thread producer([count]() {
+		TestCommand batch[37];
+		uint64_t next = 0;
+		uint64_t round = 0;
+
+		while(next < count) {
+			// 1, 2, ... 37 commands per push, wider than the free space at times
+			size_t size = size_t(std::min<uint64_t>(round++ % 37 + 1, count - next));
+			for(size_t i=0; i<size; i++)
+				batch[i] = make_command(next + i);
+
+			size_t pushed = 0;
+			while(pushed < size) {
+				size_t n = ring.push_commands(batch + pushed, size - pushed);
+				if(n == 0) std::this_thread::yield();
+				pushed += n;
+			}
+			next += size;
+		}
+	});
+
+	TestCommand batch[29];
+	uint64_t expected = 0;
+	uint64_t round = 0;
+
+	while(expected < count) {
+		size_t n = ring.pop_front(batch, round++ % 29 + 1);
+		if(n == 0) std::this_thread::yield();
+
+		for(size_t i=0; i<n; i++) {
+			if(!check_command(batch[i], expected)) {
+				if(failures++ < 8)
+					std::printf("  command %llu arrived as %llu\n", (unsigned long long) expected,
+					            (unsigned long long) batch[i].sequence);
+			}
+			expected++;
+		}
+	}
+
+	producer.join();
+
+	bool drained = ring.empty();
+	if(!drained)
+		std::printf("  ring holds %zu commands after the last one arrived\n", ring.size());
+
+	std::printf("stress: %llu commands, %llu bad, %s\n", (unsigned long long) count,
+	            (unsigned long long) failures, failures == 0 && drained ? "ok" : "FAILED");
+	return failures == 0 && drained;
+}
+
+//======================================================================//
+//                              BENCHMARK                               //
+//======================================================================//
+
+// commands per producer push and per consumer pop
+static constexpr size_t BENCH_BATCH = 64;
+
+template <typename Produce, typename Consume>
+static double time_transfer(Produce&& produce, Consume&& consume)
+{
+	auto start = std::chrono::steady_clock::now();
+
+	std::thread producer(produce);
+	consume();
+	producer.join();
+
+	return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+static double bench_ring(uint64_t count)
+{
+	static SPSCCommandBuffer<TestCommand, 1024> ring;
+	uint64_t sum = 0;
+
+	double seconds = time_transfer(
+		[count]() {
+			TestCommand batch[BENCH_BATCH];
+			for(uint64_t next=0; next<count; ) {
+				size_t size = size_t(std::min<uint64_t>(BENCH_BATCH, count - next));
+				for(size_t i=0; i<size; i++)
+					batch[i] = make_command(next + i);
+
+				for(size_t pushed=0; pushed<size; ) {
+					size_t n = ring.push_commands(batch + pushed, size - pushed);
+					if(n == 0) std::this_thread::yield();
+					pushed += n;
+				}
+				next += size;
+			}
+		},
+		[count, &sum]() {
+			TestCommand batch[BENCH_BATCH];
+			for(uint64_t received=0; received<count; ) {
+				size_t n = ring.pop_front(batch, BENCH_BATCH);
+				if(n == 0) std::this_thread::yield();
+				for(size_t i=0; i<n; i++)
+					sum += batch[i].checksum;
+				received += n;
+			}
+		});
+
+	// keeps the consumer's reads from being optimized out
+	if(sum == 1) std::printf(" ");
+	return seconds;
+}
+
+static double bench_mutex(uint64_t count)
+{
+	MutexCommandQueue<TestCommand> queue;
+	uint64_t sum = 0;
+
+	double seconds = time_transfer(
+		[count, &queue]() {
+			TestCommand batch[BENCH_BATCH];
+			for(uint64_t next=0; next<count; ) {
+				size_t size = size_t(std::min<uint64_t>(BENCH_BATCH, count - next));
+				for(size_t i=0; i<size; i++)
+					batch[i] = make_command(next + i);
+
+				queue.push_commands(batch, size);
+				next += size;
+			}
+		},
+		[count, &queue, &sum]() {
+			std::vector<TestCommand> commands;
+			for(uint64_t received=0; received<count; ) {
+				queue.pop_all(commands);
+				if(commands.empty()) std::this_thread::yield();
+				for(const TestCommand& command : commands)
+					sum += command.checksum;
+				received += commands.size();
+			}
+		});
+
+	if(sum == 1) std::printf(" ");
+	return seconds;
+}
+
+static void report(const char* name, uint64_t count, double seconds)
+{
+	std::printf("  %-12s %8.2f ms  %8.2f M commands/s\n", name, seconds * 1000.0, count / seconds / 1e6);
+}
+
+int main(int argc, char** argv) {
+	uint64_t count = 10000000;
+	if(argc > 1) count = std::max(1ll, std::atoll(argv[1]));
+
+	if(!run_stress(count))
+		return 1;
+
+	// best of a few runs, thread start-up and scheduling are noisy
+	double ring = 1e9, mutex = 1e9;
+	for(int run=0; run<3; run++) {
+		ring = std::min(ring, bench_ring(count));
+		mutex = std::min(mutex, bench_mutex(count));
+	}
+
+	std::printf("throughput, %llu commands of %zu bytes, batches of %zu:\n", (unsigned long long) count,
+	            sizeof(TestCommand), BENCH_BATCH);
+	report("spsc ring", count, ring);
+	report("mutex+vector", count, mutex);
+	return 0;
+}
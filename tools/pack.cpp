@@ -0,0 +1,114 @@
+#include "engine/image.hpp"
+#include "engine/asset_pack.hpp"
+
+#include <algorithm>
+#include <cctype>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <vector>
+
+// Builds an asset pack (see asset_pack.hpp) from every file under a directory.
+//
+//   pack <output> <asset dir>
+//
+// Images are decoded in parallel and stored as RGBA8 rows; anything else is
+// copied verbatim. Entries are named by their path relative to <asset dir>,
+// with '/' separators on every platform.
+
+namespace fs = std::filesystem;
+
+// images decoded at once, bounds the tool's memory on large asset trees
+static constexpr size_t DECODE_BATCH = 64;
+
+static bool is_image(const fs::path& path)
+{
+	std::string extension = path.extension().string();
+	std::transform(extension.begin(), extension.end(), extension.begin(),
+	               [](unsigned char c) { return char(std::tolower(c)); });
+
+	static const char* extensions[] = { ".png", ".jpg", ".jpeg", ".bmp", ".tga", ".gif", ".psd", ".ppm", ".pgm" };
+	return std::find(std::begin(extensions), std::end(extensions), extension) != std::end(extensions);
+}
+
+int main(int argc, char** argv) {
+	if(argc != 3) {
+		std::printf("usage: %s <output> <asset dir>\n", argv[0]);
+		return 1;
+	}
+
+	const fs::path root = argv[2];
+	std::error_code error;
+	std::vector<fs::path> images, files;
+
+	for(const fs::directory_entry& entry : fs::recursive_directory_iterator(root, error)) {
+		if(!entry.is_regular_file()) continue;
+		(is_image(entry.path()) ? images : files).push_back(entry.path());
+	}
+	if(error) {
+		std::printf("can't read %s: %s\n", argv[2], error.message().c_str());
+		return 1;
+	}
+
+	// sorted so the same assets always produce the same pack
+	std::sort(images.begin(), images.end());
+	std::sort(files.begin(), files.end());
+
+	std::vector<std::string> image_paths;
+	std::vector<const char*> image_path_ptrs;
+	for(const fs::path& path : images)
+		image_paths.push_back(path.string());
+	for(const std::string& path : image_paths)
+		image_path_ptrs.push_back(path.c_str());
+
+	AssetPackBuilder* builder = asset_pack_builder_create(argv[1]);
+	if(!builder) return 1;
+
+	bool ok = true;
+	size_t bytes = 0;
+
+	Image2D* decoded[DECODE_BATCH];
+	for(size_t first=0; first<images.size(); first+=DECODE_BATCH) {
+		size_t count = std::min(DECODE_BATCH, images.size() - first);
+		image_load_batch(image_path_ptrs.data() + first, int(count), decoded, 4);
+
+		for(size_t i=0; i<count; i++) {
+			std::string name = images[first + i].lexically_relative(root).generic_string();
+			if(!decoded[i]) {
+				std::printf("can't decode %s\n", image_paths[first + i].c_str());
+				ok = false;
+				continue;
+			}
+
+			float width, height;
+			image_get_specification(decoded[i], ImageSpec::WIDTH, width);
+			image_get_specification(decoded[i], ImageSpec::HEIGHT, height);
+			bytes += size_t(width) * size_t(height) * 4;
+
+			ok = asset_pack_add_image(builder, name.c_str(), decoded[i]) && ok;
+			image_free(decoded[i]);
+		}
+	}
+
+	for(const fs::path& path : files) {
+		std::string name = path.lexically_relative(root).generic_string();
+		std::ifstream file(path, std::ios::binary);
+		std::vector<char> data((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+		if(!file && !file.eof()) {
+			std::printf("can't read %s\n", path.string().c_str());
+			ok = false;
+			continue;
+		}
+
+		bytes += data.size();
+		ok = asset_pack_add_data(builder, name.c_str(), data.data(), data.size()) && ok;
+	}
+
+	ok = asset_pack_builder_finish(builder) && ok;
+
+	std::printf("%s: %zu images, %zu files, %.1f MiB%s\n", argv[1], images.size(), files.size(),
+	            bytes / (1024.0 * 1024.0), ok ? "" : " (with errors)");
+	return ok ? 0 : 1;
+}
@@ -0,0 +1,117 @@
+#include "engine/core.hpp"
+#include "engine/window.hpp"
+#include "engine/renderer.hpp"
+#include "engine/profiler.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+// Replays a capture written by renderer_capture_frame() through the renderer
+// in a loop and reports frame timings.
+//
+//   replay <capture> [frames] [--headless] [--software]
+//
+// --headless renders offscreen without a display (EGL, GLFW 3.4+), for CI.
+// --software draws with the CPU rasterizer instead of the GPU.
+
+static float percentile(std::vector<float> samples, float p)
+{
+	std::sort(samples.begin(), samples.end());
+	return samples[size_t((samples.size() - 1) * p)];
+}
+
+int main(int argc, char** argv) {
+	const char* capture_path = nullptr;
+	int frame_count = 1000;
+	bool headless = false;
+	RendererBackend backend = RENDERER_BACKEND_OPENGL;
+
+	for(int i=1; i<argc; i++) {
+		if(std::strcmp(argv[i], "--headless") == 0) headless = true;
+		else if(std::strcmp(argv[i], "--software") == 0) backend = RENDERER_BACKEND_SOFTWARE;
+		else if(!capture_path) capture_path = argv[i];
+		else frame_count = std::max(1, std::atoi(argv[i]));
+	}
+
+	if(!capture_path) {
+		std::printf("usage: %s <capture> [frames] [--headless] [--software]\n", argv[0]);
+		return 1;
+	}
+
+	core_init(headless);
+
+	Window* window = window_initialize(640, 480, "replay", headless ? WINDOWFLAG_HEADLESS : WINDOWFLAG_NONE);
+	if(!window) {
+		core_destroy();
+		return 1;
+	}
+
+	renderer_init(window, backend);
+	profiler_set_enabled(true);
+
+	RenderCapture* capture = renderer_load_capture(capture_path);
+	if(!capture) {
+		renderer_cleanup();
+		window_destroy(window);
+		core_destroy();
+		return 1;
+	}
+
+	// match the captured projection's aspect
+	int width, height;
+	renderer_get_capture_resolution(capture, width, height);
+	window_set_resolution(window, width, height);
+	renderer_set_viewport(width, height);
+
+	std::vector<float> frame_times;
+	frame_times.reserve(frame_count);
+
+	for(int frame=0; frame<frame_count; frame++) {
+		auto begin = std::chrono::steady_clock::now();
+
+		Camera camera = renderer_replay_capture(capture);
+		renderer_begin();
+		renderer_clear_buffer(0.0f, 0.0f, 0.0f, 1.0f);
+		renderer_draw_lines(camera);
+		renderer_draw_sprites(camera);
+		renderer_end();
+		renderer_blit(window);
+
+		{
+			ProfileScope scope(PROFILE_PASS_SWAP);
+			window_swap_buffers(window);
+		}
+		window_poll_events(window);
+
+		std::chrono::duration<float, std::milli> elapsed = std::chrono::steady_clock::now() - begin;
+		frame_times.push_back(elapsed.count());
+	}
+
+	float total = 0.0f;
+	for(float t : frame_times) total += t;
+
+	RendererStats stats = renderer_get_stats();
+	std::printf("%s: %d frames, %zu sprites, %zu lines drawn per frame\n", 
+	            capture_path, frame_count, stats.sprites_drawn, stats.lines_drawn);
+	std::printf("frame ms: avg %.3f  p50 %.3f  p95 %.3f  p99 %.3f  max %.3f\n",
+	            total / frame_times.size(), percentile(frame_times, 0.5f), 
+	            percentile(frame_times, 0.95f), percentile(frame_times, 0.99f),
+	            percentile(frame_times, 1.0f));
+
+	std::printf("%-8s %10s %10s %10s %10s\n", "pass", "cpu avg", "cpu p95", "gpu avg", "gpu p95");
+	for(int pass=0; pass<PROFILE_PASS_COUNT; pass++) {
+		ProfileTiming timing = profiler_get_timing(ProfilePass(pass));
+		std::printf("%-8s %10.3f %10.3f %10.3f %10.3f\n", profiler_pass_name(ProfilePass(pass)),
+		            timing.cpu_avg, timing.cpu_p95, timing.gpu_avg, timing.gpu_p95);
+	}
+
+	renderer_destroy_capture(capture);
+	renderer_cleanup();
+	window_destroy(window);
+	core_destroy();
+	return 0;
+}